@@ -1,20 +1,25 @@
 #include <assert.h>
+#include <ctype.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <malloc.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
 
 #define ROW(X) X / 9
 #define COL(X) X % 9
 
 /* Compute absolute position offset from a row-column coordinate. */
 #define OFFSET(ROW, COL) ROW * 9 + COL 
-
-/* Return the index of the box which corresponds to a given position. */
-#define BOX(P) lookup (ROW (P) / 3, COL (P) / 3)
-
-/* Translate an absolute position to a position relative to its box. */
-#define BOX_INDEX(P) lookup (ROW (P) % 3, COL (P) % 3)
  
 #define SET_CANDIDATE(matrix, pos, n) \
     toggle_candidate (matrix, pos, n, 1);
@@ -49,6 +54,8 @@
 #define ROW_OFFSET 0
 #define COL_OFFSET 1
 #define BOX_OFFSET 2
+#define DIAG_OFFSET 3
+#define WINDOW_OFFSET 4
 
 enum state
 {
@@ -71,6 +78,12 @@ offs_type (int offs)
         case BOX_OFFSET:
             return "BOX";
             break;
+        case DIAG_OFFSET:
+            return "DIAG";
+            break;
+        case WINDOW_OFFSET:
+            return "WINDOW";
+            break;
         default:
             return "ERROR";
     }
@@ -122,38 +135,6 @@ dump_candidates (int16_t *candidates)
     }
 }
 
-int8_t 
-lookup (int8_t a, int8_t b)
-{
-    switch (a)
-    {
-        case 0:
-            switch (b)
-            {
-                case 0: return 0;
-                case 1: return 1;
-                case 2: return 2;
-            }
-        case 1:
-            switch (b)
-            {
-                case 0: return 3;
-                case 1: return 4;
-                case 2: return 5;
-            }
-        case 2:
-            switch (b)
-            {
-                case 0: return 6;
-                case 1: return 7;
-                case 2: return 8;
-            }
-        default:
-            assert (0);
-            return -1;
-    }
-}
- 
 /* Return absolute offset from a box index and relative position. */
 int8_t
 box_offset (int8_t box, int8_t pos)
@@ -184,29 +165,215 @@ box_offset (int8_t box, int8_t pos)
     }
 }
 
+int8_t
+get_offset (int8_t i, int8_t j, int offstype)
+{
+    switch (offstype)
+    {
+        case ROW_OFFSET:    
+            return OFFSET (i, j);
+        case COL_OFFSET:    
+            return OFFSET (j, i);
+        case BOX_OFFSET: 
+            return box_offset (i, j);
+        default:
+            assert (0);
+            return -1;
+    }
+}
+
+/* An 81-bit set of grid positions. */
+typedef unsigned __int128 cellmask;
+
+#define CELL(P) ((cellmask) 1 << (P))
+
+#define ALL_CELLS (CELL (81) - 1)
+
+#define MAX_UNITS      36
+#define MAX_CELL_UNITS 8
+#define MAX_PEERS      80
+
+/* The units of the puzzle variant being solved. A unit is a set of nine 
+ * cells which must hold each value exactly once. Units 0-8 are always the
+ * rows and 9-17 the columns; units 18-26 are the boxes, or the irregular
+ * regions of a jigsaw puzzle. Variants append further units after these.
+ *
+ * The peers of a cell are the other cells which share at least one unit 
+ * with it. Unit membership and peers are also kept as cell masks.
+ */
+struct layout
+{
+    int8_t   nunits;
+    int8_t   unit[MAX_UNITS][9];
+    int8_t   kind[MAX_UNITS];           /* ROW_OFFSET, COL_OFFSET, ... */
+    int8_t   nmember[81];
+    int8_t   member[81][MAX_CELL_UNITS];/* The units a cell belongs to */
+    int8_t   npeers[81];
+    int8_t   peers[81][MAX_PEERS];
+    cellmask unit_mask[MAX_UNITS];
+    cellmask peer_mask[81];
+};
+
+struct layout layout;
+
+void
+layout_add_unit (struct layout *l, int kind, const int8_t *cells)
+{
+    assert (l->nunits < MAX_UNITS);
+
+    memcpy (l->unit[l->nunits], cells, 9);
+    l->kind[l->nunits] = kind;
+    l->nunits++;
+}
+
+/* Derive the membership, peer and mask tables from the list of units. */
+void
+layout_finish (struct layout *l)
+{
+    int8_t i, j, k;
+
+    memset (l->nmember, 0, sizeof (l->nmember));
+    memset (l->npeers, 0, sizeof (l->npeers));
+    memset (l->peer_mask, 0, sizeof (l->peer_mask));
+
+    for (i = 0; i < l->nunits; i++)
+    {
+        l->unit_mask[i] = 0;
+        for (j = 0; j < 9; j++)
+        {
+            int8_t p = l->unit[i][j];
+
+            assert (l->nmember[p] < MAX_CELL_UNITS);
+            l->member[p][l->nmember[p]++] = i;
+            l->unit_mask[i] |= CELL (p);
+        }
+    }
+
+    for (i = 0; i < 81; i++)
+    {
+        for (j = 0; j < l->nmember[i]; j++)
+            l->peer_mask[i] |= l->unit_mask[l->member[i][j]];
+        l->peer_mask[i] &= ~CELL (i);
+
+        for (k = 0; k < 81; k++)
+            if (l->peer_mask[i] & CELL (k))
+                l->peers[i][l->npeers[i]++] = k;
+    }
+}
+
+/* Build the layout of a puzzle variant. Recognized variants are "standard",
+ * "diagonal", "windoku" and "jigsaw:R", where R is a string of 81 region
+ * labels, one per cell, each used by exactly nine cells. Return 0 if the
+ * variant is not recognized or the regions are invalid.
+ */
 int
-validate_pos (const int8_t *d, int8_t p) 
+init_layout (struct layout *l, const char *variant)
 {
-    int8_t i,
-           c = COL (p),
-           r = ROW (p),
-           n = d[p],
-           s = BOX (p),
-           q = BOX_INDEX (p);
+    int8_t i, j, k, cells[9];
 
-    for (i = 0; i < 9; ++i) 
+    memset (l, 0, sizeof (struct layout));
+
+    for (i = 0; i < 9; i++)
     {
-        /* Check horizontal uniqueness constraint */
-        if (i != c && n == d[OFFSET (r, i)]) 
-            return 0;
-        /* Check vertical uniqueness constraint */
-        if (i != r && n == d[OFFSET (i, c)]) 
+        for (j = 0; j < 9; j++)
+            cells[j] = get_offset (i, j, ROW_OFFSET);
+        layout_add_unit (l, ROW_OFFSET, cells);
+    }
+    for (i = 0; i < 9; i++)
+    {
+        for (j = 0; j < 9; j++)
+            cells[j] = get_offset (i, j, COL_OFFSET);
+        layout_add_unit (l, COL_OFFSET, cells);
+    }
+
+    if (!strncmp (variant, "jigsaw:", 7))
+    {
+        const char *r = variant + 7;
+        char labels[9];
+        int8_t n = 0;
+
+        if (81 != strlen (r))
             return 0;
-        /* Check box */
-        if (i != q && n == d[box_offset (s, i)]) 
+
+        for (i = 0; i < 81; i++)
+        {
+            if (memchr (labels, r[i], n))
+                continue;
+            if (9 == n)
+                return 0;
+            labels[n++] = r[i];
+        }
+        for (i = 0; i < 9; i++)
+        {
+            for (j = k = 0; j < 81; j++)
+            {
+                if (r[j] != labels[i])
+                    continue;
+                if (9 == k)
+                    return 0;
+                cells[k++] = j;
+            }
+            if (9 != k)
+                return 0;
+            layout_add_unit (l, BOX_OFFSET, cells);
+        }
+    }
+    else
+    {
+        for (i = 0; i < 9; i++)
+        {
+            for (j = 0; j < 9; j++)
+                cells[j] = get_offset (i, j, BOX_OFFSET);
+            layout_add_unit (l, BOX_OFFSET, cells);
+        }
+
+        if (!strcmp (variant, "diagonal"))
+        {
+            for (j = 0; j < 9; j++)
+                cells[j] = OFFSET (j, j);
+            layout_add_unit (l, DIAG_OFFSET, cells);
+            for (j = 0; j < 9; j++)
+                cells[j] = OFFSET (j, 8 - j);
+            layout_add_unit (l, DIAG_OFFSET, cells);
+        }
+        else if (!strcmp (variant, "windoku"))
+        {
+            /* Four extra 3x3 windows, with top-left corners at (1, 1), 
+             * (1, 5), (5, 1) and (5, 5). 
+             */
+            for (i = 0; i < 4; i++)
+            {
+                int8_t r = 1 + (i / 2) * 4,
+                       c = 1 + (i % 2) * 4,
+                       o = OFFSET (r, c);
+
+                for (j = 0; j < 9; j++)
+                    cells[j] = o + (j / 3) * 9 + j % 3;
+                layout_add_unit (l, WINDOW_OFFSET, cells);
+            }
+        }
+        else if (strcmp (variant, "standard"))
+        {
             return 0;
+        }
     }
 
+    layout_finish (l);
+
+    return 1;
+}
+
+int
+validate_pos (const int8_t *d, int8_t p) 
+{
+    int8_t i,
+           n = d[p];
+
+    /* Check the uniqueness constraint of every unit the cell belongs to */
+    for (i = 0; i < layout.npeers[p]; ++i) 
+        if (n == d[layout.peers[p][i]]) 
+            return 0;
+
     return 1;
 }
 
@@ -275,7 +442,9 @@ init_candidates (int8_t *p, int16_t *candidates)
     }
 }
 
-/* Run brute-force algorithm integration step.
+/* Run brute-force algorithm integration step. Cells are visited in the 
+ * given order, a permutation of the 81 positions, or in natural order if
+ * the order is NULL. The cursor is an index into the order.
  *
  * Return codes:
  *
@@ -284,9 +453,10 @@ init_candidates (int8_t *p, int16_t *candidates)
  *   -1 : Final state: No solution exists.
  */
 int
-step (int8_t *d, int16_t *candidates, int8_t *cursor, enum state *state)
+step (int8_t *d, int16_t *candidates, const int8_t *order, int8_t *cursor, enum state *state)
 {
-    int8_t c = *cursor;
+    int8_t c = *cursor, 
+           x;
 
     if (81 == c && STATE_REVERSE != *state)
         return 1;
@@ -299,18 +469,20 @@ step (int8_t *d, int16_t *candidates, int8_t *cursor, enum state *state)
     {
         case STATE_EVAL:
             {
-                assert ((0b1111 & candidates[c]) > 1);
+                x = order ? order[c] : c;
 
-                while (10 != ++d[c])
+                assert ((0b1111 & candidates[x]) > 1);
+
+                while (10 != ++d[x])
                 {
-                    if (!IS_CANDIDATE (candidates, c, d[c]))
+                    if (!IS_CANDIDATE (candidates, x, d[x]))
                         continue;
-                    if (1 == validate_pos (d, c))
+                    if (1 == validate_pos (d, x))
                         break;
                 }
-                if (10 == d[c])
+                if (10 == d[x])
                 {
-                    d[c] = 0;
+                    d[x] = 0;
                     *state = STATE_REVERSE;
                 }
                 else
@@ -321,13 +493,13 @@ step (int8_t *d, int16_t *candidates, int8_t *cursor, enum state *state)
             break;
         case STATE_FORWARD:
             {
-                if (++c < 81 && (0b1111 & candidates[c]) > 1)
+                if (++c < 81 && (0b1111 & candidates[order ? order[c] : c]) > 1)
                     *state = STATE_EVAL;
             }
             break;
         case STATE_REVERSE:
             {
-                if (c-- > 0 && (0b1111 & candidates[c]) > 1)
+                if (c-- > 0 && (0b1111 & candidates[order ? order[c] : c]) > 1)
                     *state = STATE_EVAL;
             }
             break;
@@ -356,23 +528,6 @@ log2_plus1 (int16_t bits)
     }
 }
 
-int8_t
-get_offset (int8_t i, int8_t j, int offstype)
-{
-    switch (offstype)
-    {
-        case ROW_OFFSET:    
-            return OFFSET (i, j);
-        case COL_OFFSET:    
-            return OFFSET (j, i);
-        case BOX_OFFSET: 
-            return box_offset (i, j);
-        default:
-            assert (0);
-            return -1;
-    }
-}
-
 int8_t
 unset_bits (int16_t *matrix, int8_t pos, int16_t bits)
 {
@@ -421,7 +576,7 @@ deep_loop (int8_t p[], int8_t n)
 }
 
 void
-remove_naked_subset (int16_t *candidates, int8_t i, int offs, int8_t n, int *f)
+remove_naked_subset (int16_t *candidates, int8_t u, int8_t n, int *f)
 {
     int8_t  k, j[5], s;
     int16_t c[5], 
@@ -446,7 +601,7 @@ remove_naked_subset (int16_t *candidates, int8_t i, int offs, int8_t n, int *f)
         bits = 0;
         for (k = 0; k < n; k++)
         {
-            c[k] = candidates[get_offset (i, j[n - k - 1], offs)];
+            c[k] = candidates[layout.unit[u][j[n - k - 1]]];
             s = c[k] & 0b1111;
             
             /* Count the number of elements in this set */
@@ -473,13 +628,13 @@ remove_naked_subset (int16_t *candidates, int8_t i, int offs, int8_t n, int *f)
 
                 if (s == n)
                 {
-                    pos = get_offset (i, k, offs);
+                    pos = layout.unit[u][k];
 
                     if (unset_bits (candidates, pos, bits))
                     {
                         *f = 1;
 #ifndef NDEBUG
-                        printf ("Naked subset (n = %d) (offs. type = %s) elimination: %d\n", n, offs_type (offs), pos);
+                        fprintf (stderr, "Naked subset (n = %d) (offs. type = %s) elimination: %d\n", n, offs_type (layout.kind[u]), pos);
 #endif
                     }
                 }
@@ -490,12 +645,12 @@ remove_naked_subset (int16_t *candidates, int8_t i, int offs, int8_t n, int *f)
 }
 
 void
-remove_hidden_subset (int16_t *candidates, int8_t i, int offs, int8_t n, int *f)
+remove_hidden_subset (int16_t *candidates, int8_t u, int8_t n, int *f)
 {
     int8_t j, k, p[5];
     int16_t l[9], b;
 
-    /* First, we translate the row, column, or box data from a list of candidate
+    /* First, we translate the unit data from a list of candidate
      * sets (location => candidate mappings) into a candidate => location
      * mapping.
      * 
@@ -516,7 +671,7 @@ remove_hidden_subset (int16_t *candidates, int8_t i, int offs, int8_t n, int *f)
     
     for (k = 0; k < 9; k++)
     {
-        b = candidates[get_offset (i, k, offs)];
+        b = candidates[layout.unit[u][k]];
 
         b >>= 4;
 
@@ -548,14 +703,14 @@ remove_hidden_subset (int16_t *candidates, int8_t i, int offs, int8_t n, int *f)
                 {
                     if (x & (1 << k))
                     {
-                        int8_t o = get_offset (i, k, offs);            
+                        int8_t o = layout.unit[u][k];
 
                         if (candidates[o] != v)
                         {
                             candidates[o] = v;
                             *f = 1;
 #ifndef NDEBUG
-                            printf ("Hidden subset (n = %d) (offs. type = %s): %d\n", n, offs_type (offs), get_offset (i, k, offs));
+                            fprintf (stderr, "Hidden subset (n = %d) (offs. type = %s): %d\n", n, offs_type (layout.kind[u]), o);
 #endif
                         }
                     }
@@ -589,12 +744,12 @@ saturate (int8_t *d, int16_t *candidates)
             f = 1;
 
 #ifndef NDEBUG
-            printf ("Singleton elimination: %d\n", i);
+            fprintf (stderr, "Singleton elimination: %d\n", i);
 #endif
         }
     }
 
-    for (i = 0; i < 9; i++)
+    for (i = 0; i < layout.nunits; i++)
     {
         /* === Naked pairs ====================================================
          *
@@ -603,9 +758,7 @@ saturate (int8_t *d, int16_t *candidates)
          * be eliminated from all other candidate sets in the same row, 
          * column or box.  
          */
-        remove_naked_subset (candidates, i, ROW_OFFSET, 2, &f);
-        remove_naked_subset (candidates, i, COL_OFFSET, 2, &f);
-        remove_naked_subset (candidates, i, BOX_OFFSET, 2, &f);
+        remove_naked_subset (candidates, i, 2, &f);
     }
 
     /* === Naked subsets ======================================================
@@ -613,35 +766,23 @@ saturate (int8_t *d, int16_t *candidates)
      */
     for (j = 3; j <= 5; j++)
     {
-        for (i = 0; i < 9; i++)
-        {
-            remove_naked_subset (candidates, i, ROW_OFFSET, j, &f);
-            remove_naked_subset (candidates, i, COL_OFFSET, j, &f);
-            remove_naked_subset (candidates, i, BOX_OFFSET, j, &f);
-        }
+        for (i = 0; i < layout.nunits; i++)
+            remove_naked_subset (candidates, i, j, &f);
     }
 
     /* === Hidden singles =====================================================
      *
      */
-    for (i = 0; i < 9; i++)
-    {
-        remove_hidden_subset (candidates, i, ROW_OFFSET, 1, &f);
-        remove_hidden_subset (candidates, i, COL_OFFSET, 1, &f);
-        remove_hidden_subset (candidates, i, BOX_OFFSET, 1, &f);
-    }
+    for (i = 0; i < layout.nunits; i++)
+        remove_hidden_subset (candidates, i, 1, &f);
 
     /* === Hidden subsets =====================================================
      *
      */
     for (j = 2; j <= 5; j++)
     {
-        for (i = 0; i < 9; i++)
-        {
-            remove_hidden_subset (candidates, i, ROW_OFFSET, j, &f);
-            remove_hidden_subset (candidates, i, COL_OFFSET, j, &f);
-            remove_hidden_subset (candidates, i, BOX_OFFSET, j, &f);
-        }
+        for (i = 0; i < layout.nunits; i++)
+            remove_hidden_subset (candidates, i, j, &f);
     }
 
     /* === Pointing pairs =====================================================
@@ -657,109 +798,2384 @@ saturate (int8_t *d, int16_t *candidates)
     return f;
 }
 
-void
-tests ()
+/* === Digit planes ===========================================================
+ *
+ * An alternative candidate representation, transposed with respect to the
+ * candidate matrix: one 81-bit cell mask per digit, in which bit p is set if
+ * the digit is a candidate at position p. Questions of the kind "where can
+ * n go in this unit" become a single AND with a unit mask, rather than a 
+ * scan over the nine cells of the unit.
+ *
+ * Both views can hold the same information. The planes are built from the
+ * grid and converted once, one way, by planes_to_candidates (), so that the
+ * search in step () can run on either; they are not kept in sync during 
+ * the search.
+ *
+ * The two representations do not run the same deductions: 
+ * saturate_planes () applies singles, hidden singles, pointing/claiming 
+ * and X-Wing, while saturate () applies singles and naked and hidden 
+ * subsets. A run with -p therefore compares deduction sets as well as 
+ * representations, and its node counts are not comparable with those of 
+ * the cell path.
+ */
+struct planes
 {
-    int16_t candidates[81];
-    int f;
-
-    /*                xxxx987654321ssss */
-    candidates[0] = 0b00000000000100001;
-    candidates[1] = 0b00001010010000011;
-    candidates[2] = 0b00000000100000001;
-    candidates[3] = 0b00001110010010101;
-    candidates[4] = 0b00001010010000011;
-    candidates[5] = 0b00001110010010101;
-    candidates[6] = 0b00000000001000001;
-    candidates[7] = 0b00001010010000011;
-    candidates[8] = 0b00000001000000001;
+    cellmask digit[9];
+    cellmask solved;        /* Cells with an assigned value */
+};
 
-    remove_hidden_subset (candidates, 0, ROW_OFFSET, 2, &f);
+int8_t
+mask_count (cellmask m)
+{
+    return __builtin_popcountll ((uint64_t) m) 
+         + __builtin_popcountll ((uint64_t) (m >> 64));
+}
 
-    assert (0b00000000000100001 == candidates[0]);
-    assert (0b00001010010000011 == candidates[1]);
-    assert (0b00000000100000001 == candidates[2]);
-    assert (0b00000100000010010 == candidates[3]);
-    assert (0b00001010010000011 == candidates[4]);
-    assert (0b00000100000010010 == candidates[5]);
-    assert (0b00000000001000001 == candidates[6]);
-    assert (0b00001010010000011 == candidates[7]);
-    assert (0b00000001000000001 == candidates[8]);
+int8_t
+mask_first (cellmask m)
+{
+    return (uint64_t) m ? __builtin_ctzll ((uint64_t) m) 
+                        : 64 + __builtin_ctzll ((uint64_t) (m >> 64));
+}
 
-    /*                xxxx987654321ssss */
-    candidates[0] = 0b00000000100110011;
-    candidates[1] = 0b00000001101010100;
-    candidates[2] = 0b00000100000000001;
-    candidates[3] = 0b00000000010000001;
-    candidates[4] = 0b00000011100010100;
-    candidates[5] = 0b00001011000000011;
-    candidates[6] = 0b00000010000100010;
-    candidates[7] = 0b00000011000000010;
-    candidates[8] = 0b00001011000000011;
+/* Collapse the cells of a mask onto the nine lines of the given kind, i.e.,
+ * return a 9-bit set of the rows (or columns) which the mask intersects.
+ */
+int16_t
+mask_lines (cellmask m, int offs)
+{
+    int8_t  i;
+    int16_t bits = 0;
 
-    remove_hidden_subset (candidates, 0, ROW_OFFSET, 1, &f);
+    for (i = 0; i < 9; i++)
+        if (m & layout.unit_mask[offs * 9 + i])
+            bits |= (1 << i);
 
-    assert (candidates[0] == 0b00000000100110011);
-    assert (candidates[1] == 0b00000000001000001);
-    assert (candidates[2] == 0b00000100000000001);
-    assert (candidates[3] == 0b00000000010000001);
-    assert (candidates[4] == 0b00000011100010100);
-    assert (candidates[5] == 0b00001011000000011);
-    assert (candidates[6] == 0b00000010000100010);
-    assert (candidates[7] == 0b00000011000000010);
-    assert (candidates[8] == 0b00001011000000011);
+    return bits;
 }
 
 void
-tests2 ()
+planes_init (const int8_t *p, struct planes *s)
 {
-    /*
+    int8_t i, n;
+
+    for (n = 0; n < 9; n++)
+        s->digit[n] = ALL_CELLS;
+    s->solved = 0;
+
+    for (i = 0; i < 81; i++)
     {
-        int16_t candidates[81];
-    
-        int8_t p[] = 
-        {
-            0,0,0, 0,0,2, 0,0,0,
-            0,8,0, 0,6,0, 0,1,0,
-            2,0,6, 0,0,0, 5,0,9,
-    
-            0,0,8, 0,0,0, 0,0,2,
-            0,1,0, 0,8,0, 0,7,0,
-            5,0,0, 0,0,0, 1,0,0,
-    
-            3,0,1, 0,0,0, 9,0,5,
-            0,4,0, 0,7,0, 0,6,0,
-            0,0,0, 1,0,0, 0,0,0
-        };
-    
-        init_candidates (p, candidates);
-    
-        while (saturate (p, candidates))
-            printf ("-\n");
-    
-        {
-            int8_t r, cursor = -2;
-            enum state state = STATE_FORWARD;
-    
-            r = 0;
-            while (0 == r)
-                r = step (p, candidates, &cursor, &state);
-        }
-    
-        dump (p);
+        if (!p[i])
+            continue;
+
+        for (n = 0; n < 9; n++)
+            s->digit[n] &= ~CELL (i);
+
+        s->digit[p[i] - 1] |= CELL (i);
+        s->digit[p[i] - 1] &= ~layout.peer_mask[i];
+        s->solved |= CELL (i);
     }
-    {
-        int16_t candidates[81];
-    
-        int8_t p[] = 
-        {
-            8,0,0, 0,0,0, 0,0,0,
-            0,0,3, 6,0,0, 0,0,0,
-            0,7,0, 0,9,0, 2,0,0,
-    
-            0,5,0, 0,0,7, 0,0,0,
-            0,0,0, 0,4,5, 7,0,0,
-            0,0,0, 1,0,0, 0,3,0,
+}
+
+void
+planes_to_candidates (const struct planes *s, int16_t *candidates)
+{
+    int8_t i, n;
+
+    memset (candidates, 0, sizeof (int16_t) * 81);
+
+    for (n = 0; n < 9; n++)
+        for (i = 0; i < 81; i++)
+            if (s->digit[n] & CELL (i))
+                SET_CANDIDATE (candidates, i, n + 1);
+}
+
+/* Return the cells which no digit plane covers. Any such cell makes the
+ * puzzle unsolvable.
+ */
+cellmask
+planes_empty (const struct planes *s)
+{
+    int8_t   n;
+    cellmask m = 0;
+
+    for (n = 0; n < 9; n++)
+        m |= s->digit[n];
+
+    return ALL_CELLS & ~m;
+}
+
+/* Counterpart of saturate () for the digit plane representation, with the
+ * deductions listed above struct planes. Returns 1 if any change took 
+ * place.
+ */
+int
+saturate_planes (int8_t *d, struct planes *s)
+{
+    int8_t   i, j, n, o;
+    cellmask ones, twos, m, x;
+    int f = 0;
+
+    /* === Singleton elimination ==============================================
+     *
+     * Cells with exactly one candidate are found for the whole grid at 
+     * once, by counting the planes covering each cell with a saturating 
+     * two-bit counter.
+     */
+    ones = twos = 0;
+    for (n = 0; n < 9; n++)
+    {
+        twos |= ones & s->digit[n];
+        ones |= s->digit[n];
+    }
+
+    for (x = ones & ~twos & ~s->solved; x; x &= x - 1)
+    {
+        i = mask_first (x);
+
+        for (n = 0; n < 9; n++)
+            if (s->digit[n] & CELL (i))
+                break;
+
+        /* A singleton of the same digit in a peer, placed earlier in this
+         * pass, has taken the last candidate; planes_empty () reports it.
+         */
+        if (9 == n)
+            continue;
+
+        d[i] = n + 1;
+        s->solved |= CELL (i);
+        s->digit[n] &= ~layout.peer_mask[i];
+        f = 1;
+
+#ifndef NDEBUG
+        fprintf (stderr, "Singleton elimination: %d\n", i);
+#endif
+    }
+
+    /* === Hidden singles =====================================================
+     *
+     */
+    for (j = 0; j < layout.nunits; j++)
+    {
+        for (n = 0; n < 9; n++)
+        {
+            m = s->digit[n] & layout.unit_mask[j];
+
+            if (1 != mask_count (m))
+                continue;
+
+            for (o = 0; o < 9; o++)
+            {
+                if (o != n && (s->digit[o] & m))
+                {
+                    s->digit[o] &= ~m;
+                    f = 1;
+#ifndef NDEBUG
+                    fprintf (stderr, "Hidden single (offs. type = %s): %d\n", offs_type (layout.kind[j]), mask_first (m));
+#endif
+                }
+            }
+        }
+    }
+
+    /* === Pointing and claiming ==============================================
+     *
+     * If the candidates for n within a unit all lie in its intersection 
+     * with another unit, n can be removed from the rest of that other unit.
+     * With a box and a line, this is a pointing pair when the box is the
+     * first unit, and box-line claiming when it is the second.
+     */
+    for (i = 0; i < layout.nunits; i++)
+    {
+        for (j = 0; j < layout.nunits; j++)
+        {
+            cellmask a = layout.unit_mask[i],
+                     b = layout.unit_mask[j];
+
+            if (i == j || 2 > mask_count (a & b))
+                continue;
+
+            for (n = 0; n < 9; n++)
+            {
+                m = s->digit[n] & a;
+                if (m && !(m & ~b) && (s->digit[n] & b & ~a))
+                {
+                    s->digit[n] &= ~(b & ~a);
+                    f = 1;
+#ifndef NDEBUG
+                    fprintf (stderr, "Pointing (offs. type = %s): %d\n", offs_type (layout.kind[j]), n + 1);
+#endif
+                }
+            }
+        }
+    }
+
+    /* === X-Wing =============================================================
+     *
+     * Two rows in which n is confined to the same two columns; n can then be
+     * removed from the rest of those columns. Likewise with rows and columns 
+     * exchanged.
+     */
+    for (n = 0; n < 9; n++)
+    {
+        int offs;
+
+        for (offs = ROW_OFFSET; offs <= COL_OFFSET; offs++)
+        {
+            int cover = (ROW_OFFSET == offs) ? COL_OFFSET : ROW_OFFSET;
+            int16_t lines[9];
+
+            for (i = 0; i < 9; i++)
+                lines[i] = mask_lines (s->digit[n] & layout.unit_mask[offs * 9 + i], cover);
+
+            for (i = 0; i < 9; i++)
+            {
+                if (2 != bitcount (lines[i]))
+                    continue;
+
+                for (j = i + 1; j < 9; j++)
+                {
+                    if (lines[j] != lines[i])
+                        continue;
+
+                    m = 0;
+                    for (o = 0; o < 9; o++)
+                        if (lines[i] & (1 << o))
+                            m |= layout.unit_mask[cover * 9 + o];
+
+                    m &= ~(layout.unit_mask[offs * 9 + i] | layout.unit_mask[offs * 9 + j]);
+
+                    if (s->digit[n] & m)
+                    {
+                        s->digit[n] &= ~m;
+                        f = 1;
+#ifndef NDEBUG
+                        fprintf (stderr, "X-Wing (offs. type = %s): %d\n", offs_type (offs), n + 1);
+#endif
+                    }
+                }
+            }
+        }
+    }
+
+    return f;
+}
+
+/* === Chains =================================================================
+ *
+ * Wing and coloring techniques, run by saturate_with () on the candidate
+ * matrix when selected. Each of them works on a view of the unsolved cells
+ * in which values already placed in a peer are no longer counted as
+ * candidates: eff[p] holds the 9-bit candidate set of position p, and 
+ * plane[n] the cells where n + 1 remains a candidate. Cells which see each
+ * other are found with the peer masks of the layout rather than by 
+ * scanning units.
+ */
+#define TECH_XY_WING  0x1
+#define TECH_XYZ_WING 0x2
+#define TECH_COLORING 0x4
+#define TECH_ALL      0x7
+
+void
+chain_view (const int8_t *d, const int16_t *candidates, int16_t *eff, cellmask *plane)
+{
+    cellmask placed[9];
+    int8_t   i, n;
+
+    memset (placed, 0, sizeof (placed));
+    memset (plane, 0, sizeof (cellmask) * 9);
+
+    for (i = 0; i < 81; i++)
+        if (d[i])
+            placed[d[i] - 1] |= CELL (i);
+
+    for (i = 0; i < 81; i++)
+    {
+        eff[i] = 0;
+        if (d[i])
+            continue;
+
+        for (n = 0; n < 9; n++)
+        {
+            if (IS_CANDIDATE (candidates, i, n + 1) && !(layout.peer_mask[i] & placed[n]))
+            {
+                eff[i] |= (1 << n);
+                plane[n] |= CELL (i);
+            }
+        }
+    }
+}
+
+/* Remove value n + 1 from every cell of a mask. Return 1 if any was removed. */
+int
+chain_eliminate (int16_t *candidates, int16_t *eff, cellmask *plane, int8_t n, cellmask m)
+{
+    int f = 0;
+
+    for (m &= plane[n]; m; m &= m - 1)
+    {
+        int8_t i = mask_first (m);
+
+        CLEAR_CANDIDATE (candidates, i, n + 1);
+        eff[i] &= ~(1 << n);
+        plane[n] &= ~CELL (i);
+        f = 1;
+    }
+
+    return f;
+}
+
+/* === XY-Wing ================================================================
+ *
+ * A pivot cell with candidates {a, b} sees two cells with candidates 
+ * {a, c} and {b, c}. Whichever value the pivot takes, one of these two 
+ * cells holds c, so c can be removed from every cell that sees both.
+ */
+int
+remove_xy_wing (int16_t *candidates, int16_t *eff, cellmask *plane)
+{
+    int8_t   p, q, r, n;
+    cellmask m, bivalue = 0;
+    int f = 0;
+
+    for (p = 0; p < 81; p++)
+        if (2 == bitcount (eff[p]))
+            bivalue |= CELL (p);
+
+    /* Eliminations may shrink cells of the bivalue mask, so every cell is 
+     * checked again before use. */
+    for (p = 0; p < 81; p++)
+    {
+        if (2 != bitcount (eff[p]))
+            continue;
+
+        for (m = bivalue & layout.peer_mask[p]; m; m &= m - 1)
+        {
+            int16_t c;
+            cellmask k;
+
+            q = mask_first (m);
+
+            /* The first pincer shares exactly one value with the pivot */
+            c = eff[q] & ~eff[p];
+            if (2 != bitcount (eff[q]) || 1 != bitcount (c))
+                continue;
+
+            for (k = m & (m - 1); k; k &= k - 1)
+            {
+                r = mask_first (k);
+
+                /* The second pincer holds c and the other value of the pivot */
+                if (eff[r] != (c | (eff[p] & ~eff[q])))
+                    continue;
+
+                n = log2_plus1 (c) - 1;
+                if (chain_eliminate (candidates, eff, plane, n, 
+                                     layout.peer_mask[q] & layout.peer_mask[r]))
+                {
+                    f = 1;
+#ifndef NDEBUG
+                    fprintf (stderr, "XY-Wing elimination: %d (pivot %d)\n", n + 1, p);
+#endif
+                }
+            }
+        }
+    }
+
+    return f;
+}
+
+/* === XYZ-Wing ===============================================================
+ *
+ * As an XY-Wing, but with a pivot {x, y, z} and pincers {x, z} and {y, z}.
+ * Since the pivot may hold z itself, only cells which see all three cells
+ * lose z.
+ */
+int
+remove_xyz_wing (int16_t *candidates, int16_t *eff, cellmask *plane)
+{
+    int8_t   p, q, r, n;
+    cellmask m, k, bivalue = 0;
+    int f = 0;
+
+    for (p = 0; p < 81; p++)
+        if (2 == bitcount (eff[p]))
+            bivalue |= CELL (p);
+
+    for (p = 0; p < 81; p++)
+    {
+        if (3 != bitcount (eff[p]))
+            continue;
+
+        for (m = bivalue & layout.peer_mask[p]; m; m &= m - 1)
+        {
+            q = mask_first (m);
+            if (2 != bitcount (eff[q]) || (eff[q] & ~eff[p]))
+                continue;
+
+            for (k = m & (m - 1); k; k &= k - 1)
+            {
+                int16_t z;
+
+                r = mask_first (k);
+                if (2 != bitcount (eff[r]) || (eff[r] & ~eff[p]) || eff[r] == eff[q])
+                    continue;
+
+                z = eff[q] & eff[r];
+                n = log2_plus1 (z) - 1;
+                if (chain_eliminate (candidates, eff, plane, n, 
+                                     layout.peer_mask[p] 
+                                   & layout.peer_mask[q] 
+                                   & layout.peer_mask[r]))
+                {
+                    f = 1;
+#ifndef NDEBUG
+                    fprintf (stderr, "XYZ-Wing elimination: %d (pivot %d)\n", n + 1, p);
+#endif
+                }
+            }
+        }
+    }
+
+    return f;
+}
+
+/* === Simple coloring ========================================================
+ *
+ * If value n is a candidate in exactly two cells of a unit, one of them 
+ * holds it; these conjugate pairs link the cells of a digit plane into
+ * chains, whose cells are colored alternately. Exactly one color of each 
+ * chain is true, so:
+ *
+ *   - if two cells of the same color see each other, that color is false,
+ *     and n is removed from all of its cells;
+ *   - a cell outside the chain which sees both colors cannot hold n.
+ */
+int
+remove_coloring (int16_t *candidates, int16_t *eff, cellmask *plane)
+{
+    int8_t   i, j, n;
+    cellmask link[81], done;
+    int f = 0;
+
+    for (n = 0; n < 9; n++)
+    {
+        memset (link, 0, sizeof (link));
+
+        for (j = 0; j < layout.nunits; j++)
+        {
+            cellmask m = plane[n] & layout.unit_mask[j];
+
+            if (2 == mask_count (m))
+            {
+                int8_t a = mask_first (m),
+                       b = mask_first (m & (m - 1));
+
+                link[a] |= CELL (b);
+                link[b] |= CELL (a);
+            }
+        }
+
+        for (done = 0, i = 0; i < 81; i++)
+        {
+            cellmask color[2], frontier, next, x;
+            int8_t   k;
+
+            if (!link[i] || (done & CELL (i)))
+                continue;
+
+            /* Color the chain containing cell i, breadth first */
+            color[0] = frontier = CELL (i);
+            color[1] = 0;
+            for (k = 1; frontier; k ^= 1)
+            {
+                for (next = 0, x = frontier; x; x &= x - 1)
+                    next |= link[mask_first (x)];
+                frontier = next & ~(color[0] | color[1]);
+                color[k] |= frontier;
+            }
+            done |= color[0] | color[1];
+
+            for (k = 0; k < 2; k++)
+            {
+                for (x = color[k]; x; x &= x - 1)
+                    if (layout.peer_mask[mask_first (x)] & color[k])
+                        break;
+
+                if (x && chain_eliminate (candidates, eff, plane, n, color[k]))
+                {
+                    f = 1;
+#ifndef NDEBUG
+                    fprintf (stderr, "Coloring (color wrap) elimination: %d\n", n + 1);
+#endif
+                }
+            }
+
+            for (x = plane[n] & ~(color[0] | color[1]); x; x &= x - 1)
+            {
+                j = mask_first (x);
+                if ((layout.peer_mask[j] & color[0]) && (layout.peer_mask[j] & color[1])
+                        && chain_eliminate (candidates, eff, plane, n, CELL (j)))
+                {
+                    f = 1;
+#ifndef NDEBUG
+                    fprintf (stderr, "Coloring (color trap) elimination: %d\n", j);
+#endif
+                }
+            }
+        }
+    }
+
+    return f;
+}
+
+/* As saturate (). Once a pass of saturate () changes nothing, the selected
+ * chain techniques run instead; the caller loops again if they eliminated
+ * anything. Their cost is thus paid once per fixpoint rather than per pass.
+ */
+int
+saturate_with (int8_t *d, int16_t *candidates, unsigned techniques)
+{
+    int16_t  eff[81];
+    cellmask plane[9];
+    int f = saturate (d, candidates);
+
+    if (f || !techniques)
+        return f;
+
+    chain_view (d, candidates, eff, plane);
+
+    if (techniques & TECH_XY_WING)
+        f |= remove_xy_wing (candidates, eff, plane);
+    if (techniques & TECH_XYZ_WING)
+        f |= remove_xyz_wing (candidates, eff, plane);
+    if (techniques & TECH_COLORING)
+        f |= remove_coloring (candidates, eff, plane);
+
+    return f;
+}
+
+/* Return 1 if the candidate matrix left by saturate_with () holds a 
+ * contradiction: an empty cell without candidates, or a value placed twice
+ * in a unit. The search in step () assumes neither, and would otherwise 
+ * pass such a grid off as a solution.
+ */
+int
+cells_contradiction (const int8_t *d, const int16_t *candidates)
+{
+    int8_t i;
+
+    for (i = 0; i < 81; i++)
+        if (d[i] ? !validate_pos (d, i) : !(candidates[i] & 0b1111))
+            return 1;
+
+    return 0;
+}
+
+/* === Hardware performance counters ==========================================
+ *
+ * When enabled in batch mode, a group of hardware counters runs alongside 
+ * the solver, and every change of solver phase attributes the events since
+ * the previous change to the phase being left. Counters measure the calling
+ * thread only; threads which solve on behalf of another open their own, 
+ * and their counts are added in with perf_add ().
+ */
+enum phase
+{
+    PHASE_NONE,
+    PHASE_INIT,             /* Building the candidate state */
+    PHASE_SATURATE,         /* Propagation */
+    PHASE_SEARCH,           /* step () */
+    PHASES
+};
+
+#define PERF_EVENTS 5
+
+struct perf
+{
+    int        fd[PERF_EVENTS];
+    int        leader;
+    int        n;               /* Number of counters opened */
+    int8_t     slot[PERF_EVENTS];/* Position of each counter in a group read */
+    enum phase phase;
+    uint64_t   last[PERF_EVENTS];
+    uint64_t   count[PHASES][PERF_EVENTS];
+};
+
+const char *perf_names[PERF_EVENTS] =
+{
+    "cycles", "instructions", "branch-misses", "L1D-misses", "LLC-misses"
+};
+
+/* Active counters of the current thread, or NULL when counting is disabled. */
+_Thread_local struct perf *perf = NULL;
+
+#ifdef __linux__
+
+int
+perf_open (struct perf *c)
+{
+    struct perf_event_attr attr;
+    int i;
+    const uint32_t type[PERF_EVENTS] =
+    {
+        PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, 
+        PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE
+    };
+    const uint64_t config[PERF_EVENTS] =
+    {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_BRANCH_MISSES,
+        PERF_COUNT_HW_CACHE_L1D 
+            | (PERF_COUNT_HW_CACHE_OP_READ << 8) 
+            | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+        PERF_COUNT_HW_CACHE_MISSES
+    };
+
+    memset (c, 0, sizeof (struct perf));
+    c->leader = -1;
+
+    for (i = 0; i < PERF_EVENTS; i++)
+    {
+        memset (&attr, 0, sizeof (attr));
+        attr.size = sizeof (attr);
+        attr.type = type[i];
+        attr.config = config[i];
+        attr.disabled = (-1 == c->leader);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+
+        /* Counters the machine does not support are left out. */
+        c->fd[i] = syscall (SYS_perf_event_open, &attr, 0, -1, c->leader, 0);
+        c->slot[i] = -1;
+        if (-1 == c->fd[i])
+            continue;
+        if (-1 == c->leader)
+            c->leader = c->fd[i];
+        c->slot[i] = c->n++;
+    }
+
+    if (-1 == c->leader)
+        return 0;
+
+    ioctl (c->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl (c->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+    return 1;
+}
+
+void
+perf_close (struct perf *c)
+{
+    int i;
+
+    for (i = 0; i < PERF_EVENTS; i++)
+        if (-1 != c->fd[i])
+            close (c->fd[i]);
+}
+
+/* Attribute the events counted since the last call to the current phase,
+ * and enter the given phase.
+ */
+void
+perf_switch (enum phase phase)
+{
+    uint64_t v[PERF_EVENTS + 1];
+    int i;
+
+    if (!perf)
+        return;
+
+    if (0 < read (perf->leader, v, sizeof (uint64_t) * (perf->n + 1)))
+    {
+        for (i = 0; i < PERF_EVENTS; i++)
+        {
+            if (-1 == perf->slot[i])
+                continue;
+            perf->count[perf->phase][i] += v[perf->slot[i] + 1] - perf->last[i];
+            perf->last[i] = v[perf->slot[i] + 1];
+        }
+    }
+
+    perf->phase = phase;
+}
+
+#else
+
+int
+perf_open (struct perf *c)
+{
+    return 0;
+}
+
+void
+perf_close (struct perf *c)
+{
+}
+
+void
+perf_switch (enum phase phase)
+{
+}
+
+#endif
+
+/* Add the counts of every phase of one set of counters to another. */
+void
+perf_add (struct perf *to, const struct perf *from)
+{
+    int i, j;
+
+    for (i = 0; i < PHASES; i++)
+        for (j = 0; j < PERF_EVENTS; j++)
+            to->count[i][j] += from->count[i][j];
+}
+
+void
+perf_report (FILE *f, const struct perf *c)
+{
+    const char *phases[PHASES] = { "other", "init", "saturate", "search" };
+    int8_t i, j;
+
+    fprintf (f, "%-10s", "phase");
+    for (j = 0; j < PERF_EVENTS; j++)
+        fprintf (f, " %14s", perf_names[j]);
+    fprintf (f, " %6s %8s %8s %8s\n", "IPC", "brmis/kI", "L1D/kI", "LLC/kI");
+
+    for (i = PHASE_INIT; i < PHASES; i++)
+    {
+        const uint64_t *v = c->count[i];
+
+        fprintf (f, "%-10s", phases[i]);
+        for (j = 0; j < PERF_EVENTS; j++)
+        {
+            if (-1 == c->slot[j])
+                fprintf (f, " %14s", "n/a");
+            else
+                fprintf (f, " %14llu", (unsigned long long) v[j]);
+        }
+        fprintf (f, " %6.2f %8.3f %8.3f %8.3f\n", 
+                 v[0] ? (double) v[1] / v[0] : 0.0,
+                 v[1] ? 1000.0 * v[2] / v[1] : 0.0,
+                 v[1] ? 1000.0 * v[3] / v[1] : 0.0,
+                 v[1] ? 1000.0 * v[4] / v[1] : 0.0);
+    }
+}
+
+enum repr
+{
+    REPR_CELLS,             /* Candidate matrix, one entry per cell */
+    REPR_PLANES             /* Digit planes */
+};
+
+/* A solver configuration. */
+struct config
+{
+    const char *name;
+    enum repr   repr;       /* Candidate representation for propagation */
+    int         cdcl;       /* Search with the clause learning engine */
+    int         mrv;        /* Search cells with fewer candidates first */
+    unsigned    techniques; /* Chain techniques (TECH_*) for propagation */
+};
+
+/* Limits on the work spent on a single puzzle. Zero means no limit. The
+ * counters are reset by budget_start () and updated by solve ().
+ */
+struct budget
+{
+    long        max_nodes;      /* Calls to step () */
+    long        max_saturate;   /* Propagation passes */
+    double      max_seconds;    /* Wall time */
+    atomic_int *cancel;         /* Raised from any thread to abandon the puzzle */
+    atomic_int *lost;           /* Raised when another portfolio racer wins */
+    long        cdcl_after;     /* Nodes of step () before handing over to
+                                   the clause learning engine */
+
+    long        nodes;
+    long        saturations;
+    struct timespec start;
+};
+
+/* The clock is only consulted every BUDGET_CLOCK_INTERVAL nodes. */
+#define BUDGET_CLOCK_INTERVAL 1024
+
+void
+budget_start (struct budget *b)
+{
+    b->nodes = 0;
+    b->saturations = 0;
+    if (b->max_seconds > 0)
+        clock_gettime (CLOCK_MONOTONIC, &b->start);
+}
+
+double
+budget_elapsed (const struct budget *b)
+{
+    struct timespec t;
+
+    clock_gettime (CLOCK_MONOTONIC, &t);
+    return (t.tv_sec - b->start.tv_sec) + (t.tv_nsec - b->start.tv_nsec) / 1e9;
+}
+
+/* Return 1 if any limit of the budget has been reached. Reading the clock
+ * is skipped unless force_clock is set or the node count hits an interval.
+ */
+int
+budget_spent (const struct budget *b, int force_clock)
+{
+    if (!b)
+        return 0;
+    if (b->cancel && atomic_load_explicit (b->cancel, memory_order_relaxed))
+        return 1;
+    if (b->lost && atomic_load_explicit (b->lost, memory_order_relaxed))
+        return 1;
+    if (b->max_nodes && b->nodes > b->max_nodes)
+        return 1;
+    if (b->max_saturate && b->saturations > b->max_saturate)
+        return 1;
+    if (b->max_seconds > 0 
+            && (force_clock || 0 == b->nodes % BUDGET_CLOCK_INTERVAL)
+            && budget_elapsed (b) > b->max_seconds)
+        return 1;
+
+    return 0;
+}
+
+/* === Conflict-driven clause learning ========================================
+ *
+ * An alternative to the chronological search in step (), for puzzles on
+ * which it keeps running into the same conflicts. The grid is encoded as a
+ * propositional formula over the 729 variables "position p holds value n",
+ * with clauses stating that every cell holds at least and at most one value,
+ * and every unit holds each value at least and at most once. Only variables
+ * which are still candidates are encoded.
+ *
+ * Clauses are watched by their first two literals. When propagation hits a
+ * conflict, a clause is learnt at the first unique implication point, and 
+ * the search jumps back to the second-highest decision level in it, rather
+ * than to the previous decision.
+ *
+ * A literal is a variable shifted left by one, with the lowest bit set if
+ * the literal is negated. Clauses live in a single arena of ints, each 
+ * stored as its size followed by its literals, and are referred to by their
+ * offset in the arena.
+ */
+#define CDCL_VARS (81 * 9)
+
+#define VAR(P, N) ((P) * 9 + (N))
+#define POS(V) ((V) << 1)
+#define NEG(V) (((V) << 1) | 1)
+#define LIT_VAR(L) ((L) >> 1)
+
+/* Number of conflicts before the first restart. */
+#define CDCL_RESTART 100
+
+struct watches
+{
+    int *c;
+    int  n, cap;
+};
+
+struct cdcl
+{
+    int    *arena;
+    int     size, cap;
+    struct watches watch[2 * CDCL_VARS];
+    int8_t  value[CDCL_VARS];   /* 1, 0, or -1 if unassigned */
+    int8_t  saved[CDCL_VARS];   /* Last value held, used when deciding */
+    int8_t  seen[CDCL_VARS];
+    int     level[CDCL_VARS];
+    int     reason[CDCL_VARS];  /* Clause which implied the value, or -1 */
+    int     trail[CDCL_VARS];
+    int     ntrail, qhead;
+    int     lim[CDCL_VARS + 1]; /* Trail size at the start of each level */
+    int     nlevels;
+    double  activity[CDCL_VARS];
+    double  inc;
+    int     unsat;
+};
+
+int
+lit_value (const struct cdcl *s, int l)
+{
+    int8_t v = s->value[LIT_VAR (l)];
+
+    return v < 0 ? -1 : v ^ (l & 1);
+}
+
+void
+watch_push (struct watches *w, int cref)
+{
+    if (w->n == w->cap)
+    {
+        w->cap = w->cap ? w->cap * 2 : 8;
+        w->c = realloc (w->c, w->cap * sizeof (int));
+    }
+    w->c[w->n++] = cref;
+}
+
+void
+cdcl_assign (struct cdcl *s, int l, int reason)
+{
+    int v = LIT_VAR (l);
+
+    s->value[v] = !(l & 1);
+    s->level[v] = s->nlevels;
+    s->reason[v] = reason;
+    s->trail[s->ntrail++] = l;
+}
+
+/* Store a clause of two or more literals and watch its first two. */
+int
+cdcl_store (struct cdcl *s, const int *lits, int n)
+{
+    int cref = s->size;
+
+    if (s->size + n + 1 > s->cap)
+    {
+        s->cap = (s->size + n + 1) * 2;
+        s->arena = realloc (s->arena, s->cap * sizeof (int));
+    }
+    s->arena[s->size++] = n;
+    memcpy (s->arena + s->size, lits, n * sizeof (int));
+    s->size += n;
+
+    watch_push (&s->watch[lits[0]], cref);
+    watch_push (&s->watch[lits[1]], cref);
+
+    return cref;
+}
+
+/* Add a clause of the formula at decision level 0. Literals already false
+ * are dropped, and satisfied clauses are skipped altogether.
+ */
+void
+cdcl_add (struct cdcl *s, const int *lits, int n)
+{
+    int c[9], i, k = 0;
+
+    for (i = 0; i < n; i++)
+    {
+        int v = lit_value (s, lits[i]);
+
+        if (1 == v)
+            return;
+        if (-1 == v)
+            c[k++] = lits[i];
+    }
+
+    if (0 == k)
+        s->unsat = 1;
+    else if (1 == k)
+        cdcl_assign (s, c[0], -1);
+    else
+        cdcl_store (s, c, k);
+}
+
+/* Encode a set of up to nine variables of which exactly one must be true. */
+void
+cdcl_exactly_one (struct cdcl *s, const int *vars, int n)
+{
+    int lits[9] = { 0 }, i, j;
+
+    for (i = 0; i < n; i++)
+        lits[i] = POS (vars[i]);
+    cdcl_add (s, lits, n);
+
+    for (i = 0; i < n; i++)
+    {
+        for (j = i + 1; j < n; j++)
+        {
+            lits[0] = NEG (vars[i]);
+            lits[1] = NEG (vars[j]);
+            cdcl_add (s, lits, 2);
+        }
+    }
+}
+
+/* Return the conflicting clause, or -1 if propagation completed. */
+int
+cdcl_propagate (struct cdcl *s)
+{
+    while (s->qhead < s->ntrail)
+    {
+        int f = s->trail[s->qhead++] ^ 1;   /* The literal made false */
+        struct watches *w = &s->watch[f];
+        int i, j, k;
+
+        for (i = j = 0; i < w->n; i++)
+        {
+            int  cref = w->c[i],
+                 n = s->arena[cref],
+                *c = s->arena + cref + 1;
+
+            /* Keep the false literal in the second position */
+            if (c[0] == f)
+            {
+                c[0] = c[1];
+                c[1] = f;
+            }
+
+            if (1 == lit_value (s, c[0]))
+            {
+                w->c[j++] = cref;
+                continue;
+            }
+
+            /* Look for a new literal to watch */
+            for (k = 2; k < n; k++)
+                if (0 != lit_value (s, c[k]))
+                    break;
+
+            if (k < n)
+            {
+                c[1] = c[k];
+                c[k] = f;
+                watch_push (&s->watch[c[1]], cref);
+                continue;
+            }
+
+            w->c[j++] = cref;
+
+            if (0 == lit_value (s, c[0]))
+            {
+                while (++i < w->n)
+                    w->c[j++] = w->c[i];
+                w->n = j;
+                return cref;
+            }
+
+            cdcl_assign (s, c[0], cref);
+        }
+        w->n = j;
+    }
+
+    return -1;
+}
+
+void
+cdcl_bump (struct cdcl *s, int v)
+{
+    int i;
+
+    if ((s->activity[v] += s->inc) > 1e100)
+    {
+        for (i = 0; i < CDCL_VARS; i++)
+            s->activity[i] *= 1e-100;
+        s->inc *= 1e-100;
+    }
+}
+
+/* Derive a clause from a conflict by resolving on its literals of the
+ * current decision level, in reverse trail order, until only one of them
+ * remains: the first unique implication point. The learnt clause is stored
+ * in learnt, asserting literal first and the literal of the highest 
+ * remaining level second. Return the size of the clause, and the level to 
+ * jump back to in btlevel.
+ */
+int
+cdcl_analyze (struct cdcl *s, int confl, int *learnt, int *btlevel)
+{
+    int n = 1, path = 0, p = -1, idx = s->ntrail - 1, i, k;
+
+    do
+    {
+        int  size = s->arena[confl],
+            *c = s->arena + confl + 1;
+
+        /* The first literal of a reason clause is the one it implied */
+        for (i = (-1 == p) ? 0 : 1; i < size; i++)
+        {
+            int v = LIT_VAR (c[i]);
+
+            if (s->seen[v] || 0 == s->level[v])
+                continue;
+
+            s->seen[v] = 1;
+            cdcl_bump (s, v);
+
+            if (s->level[v] >= s->nlevels)
+                path++;
+            else
+                learnt[n++] = c[i];
+        }
+
+        while (!s->seen[LIT_VAR (s->trail[idx])])
+            idx--;
+
+        p = s->trail[idx--];
+        confl = s->reason[LIT_VAR (p)];
+        s->seen[LIT_VAR (p)] = 0;
+
+    } while (--path > 0);
+
+    learnt[0] = p ^ 1;
+
+    *btlevel = 0;
+    for (i = 1, k = 1; i < n; i++)
+    {
+        s->seen[LIT_VAR (learnt[i])] = 0;
+        if (s->level[LIT_VAR (learnt[i])] > *btlevel)
+        {
+            *btlevel = s->level[LIT_VAR (learnt[i])];
+            k = i;
+        }
+    }
+    if (n > 1)
+    {
+        int t = learnt[1];
+
+        learnt[1] = learnt[k];
+        learnt[k] = t;
+    }
+
+    return n;
+}
+
+void
+cdcl_backjump (struct cdcl *s, int level)
+{
+    int i;
+
+    /* Level 0 has no limit of its own; assignments there are permanent */
+    if (level >= s->nlevels)
+        return;
+
+    for (i = s->ntrail - 1; i >= s->lim[level]; i--)
+    {
+        int v = LIT_VAR (s->trail[i]);
+
+        s->saved[v] = s->value[v];
+        s->value[v] = -1;
+    }
+    s->ntrail = s->qhead = s->lim[level];
+    s->nlevels = level;
+}
+
+/* Return the unassigned variable of highest activity, or -1. */
+int
+cdcl_pick (const struct cdcl *s)
+{
+    int i, v = -1;
+
+    for (i = 0; i < CDCL_VARS; i++)
+        if (s->value[i] < 0 && (-1 == v || s->activity[i] > s->activity[v]))
+            v = i;
+
+    return v;
+}
+
+/* Solve a grid with the clause learning engine. If a candidate matrix is 
+ * given, eliminated candidates are left out of the encoding; otherwise it 
+ * is computed from the grid. Decisions and conflicts count as nodes towards
+ * the budget, which is not restarted.
+ *
+ * Return codes are those of solve ().
+ */
+int
+cdcl_run (int8_t *p, const int16_t *candidates, struct budget *b)
+{
+    struct cdcl *s;
+    int16_t c[81];
+    int     vars[9], learnt[CDCL_VARS];
+    int     i, j, k, n, r = 0;
+    long    conflicts = 0, 
+            restart = CDCL_RESTART;
+
+    if (!candidates)
+    {
+        init_candidates (p, c);
+        candidates = c;
+    }
+
+    s = calloc (1, sizeof (struct cdcl));
+    memset (s->value, -1, sizeof (s->value));
+    memset (s->saved, 1, sizeof (s->saved));
+    s->inc = 1;
+
+    /* Eliminated candidates are false from the outset. The activities of
+     * the others are seeded so that cells with few candidates go first.
+     */
+    for (i = 0; i < 81; i++)
+    {
+        for (j = 0; j < 9; j++)
+        {
+            if (IS_CANDIDATE (candidates, i, j + 1))
+                s->activity[VAR (i, j)] = 1.0 / (candidates[i] & 0b1111);
+            else
+                cdcl_assign (s, NEG (VAR (i, j)), -1);
+        }
+    }
+
+    for (i = 0; i < 81 && !s->unsat; i++)
+    {
+        for (j = n = 0; j < 9; j++)
+            if (IS_CANDIDATE (candidates, i, j + 1))
+                vars[n++] = VAR (i, j);
+        cdcl_exactly_one (s, vars, n);
+    }
+
+    for (i = 0; i < layout.nunits && !s->unsat; i++)
+    {
+        for (j = 0; j < 9; j++)
+        {
+            for (k = n = 0; k < 9; k++)
+                if (IS_CANDIDATE (candidates, layout.unit[i][k], j + 1))
+                    vars[n++] = VAR (layout.unit[i][k], j);
+            cdcl_exactly_one (s, vars, n);
+        }
+    }
+
+    while (!r && !s->unsat)
+    {
+        int confl = cdcl_propagate (s);
+
+        if (b)
+            b->nodes++;
+
+        if (-1 != confl)
+        {
+            int level;
+
+            if (0 == s->nlevels)
+            {
+                r = -1;
+                break;
+            }
+
+            n = cdcl_analyze (s, confl, learnt, &level);
+            cdcl_backjump (s, level);
+            cdcl_assign (s, learnt[0], (1 == n) ? -1 : cdcl_store (s, learnt, n));
+
+            s->inc /= 0.95;
+
+            if (++conflicts >= restart)
+            {
+                cdcl_backjump (s, 0);
+                restart += restart / 2;
+            }
+        }
+        else
+        {
+            int v = cdcl_pick (s);
+
+            if (-1 == v)
+            {
+                r = 1;
+                break;
+            }
+
+            s->lim[s->nlevels++] = s->ntrail;
+            cdcl_assign (s, s->saved[v] ? POS (v) : NEG (v), -1);
+        }
+
+        if (budget_spent (b, 0))
+            r = 2;
+    }
+
+    if (s->unsat)
+        r = -1;
+
+    if (1 == r)
+        for (i = 0; i < 81; i++)
+            for (j = 0; j < 9; j++)
+                if (1 == s->value[VAR (i, j)])
+                    p[i] = j + 1;
+
+    for (i = 0; i < 2 * CDCL_VARS; i++)
+        free (s->watch[i].c);
+    free (s->arena);
+    free (s);
+
+    return r;
+}
+
+/* Solve a puzzle with the clause learning engine alone. */
+int
+solve_cdcl (int8_t *p, struct budget *b)
+{
+    int r;
+
+    if (b)
+        budget_start (b);
+
+    perf_switch (PHASE_SEARCH);
+    r = cdcl_run (p, NULL, b);
+
+    return r;
+}
+
+/* === Transposition table ====================================================
+ *
+ * With a fixed cell order, a search never reaches the same board twice, 
+ * but it does reach the same remainder: what is left to solve depends only
+ * on which cells are still empty and, for every unit holding one of them,
+ * on the set of values already used in it. Prefixes which differ only in
+ * the order of values within units, or in units already complete, lead to
+ * the same remainder. A remainder for which the search has exhausted every
+ * value of the next cell, without finding a solution, is recorded as dead;
+ * any search that reaches it again can drop it at once.
+ *
+ * A remainder is hashed by XOR-ing one random key per empty cell and one 
+ * per (unit, value) pair for the units which still hold an empty cell, 
+ * together with a hash of the clues, so that remainders of different 
+ * puzzles never meet. struct remainder keeps the hash up to date as step ()
+ * assigns and clears cells. Within one puzzle, every configuration may 
+ * share the table: candidates only ever lose values which no solution 
+ * holds, so a dead remainder is dead under any of them.
+ *
+ * The table is a fixed array of 64-bit words holding the hashes of dead
+ * remainders, read and written with relaxed atomics so that concurrent 
+ * searches can share it without locks. A hash is looked for in TT_PROBE 
+ * consecutive slots; when all of them are taken, the first is overwritten.
+ */
+#define TT_PROBE 4
+
+/* Dead ends found in fewer search nodes than this are not worth a slot. */
+#define TT_MIN_NODES 16
+
+uint64_t zobrist[81][10];               /* Value 0 keys an empty cell */
+uint64_t zobrist_unit[MAX_UNITS][9];
+
+struct ttable
+{
+    _Atomic uint64_t *slots;
+    uint64_t          mask;
+    atomic_long       hits;
+};
+
+struct remainder
+{
+    uint64_t hash;
+    uint64_t used[MAX_UNITS];           /* Keys of the values used in each unit */
+    int8_t   empty[MAX_UNITS];          /* Empty cells in each unit */
+    int8_t   cells;                     /* Empty cells in the grid */
+};
+
+/* splitmix64 */
+uint64_t
+next_key (uint64_t *x)
+{
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ULL);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+void
+init_zobrist ()
+{
+    uint64_t x = 0x9e3779b97f4a7c15ULL;
+    int8_t   i, j;
+
+    for (i = 0; i < 81; i++)
+        for (j = 0; j < 10; j++)
+            zobrist[i][j] = next_key (&x);
+
+    for (i = 0; i < MAX_UNITS; i++)
+        for (j = 0; j < 9; j++)
+            zobrist_unit[i][j] = next_key (&x);
+}
+
+/* Hash the clues of a puzzle. */
+uint64_t
+board_hash (const int8_t *p)
+{
+    uint64_t h = 0;
+    int8_t   i;
+
+    for (i = 0; i < 81; i++)
+        if (p[i])
+            h ^= zobrist[i][p[i]];
+
+    return h;
+}
+
+void
+remainder_init (struct remainder *rm, const int8_t *p, uint64_t clues)
+{
+    int8_t i, j;
+
+    rm->hash = clues;
+
+    for (i = 0; i < layout.nunits; i++)
+    {
+        rm->used[i] = 0;
+        rm->empty[i] = 0;
+        for (j = 0; j < 9; j++)
+        {
+            int8_t n = p[layout.unit[i][j]];
+
+            if (n)
+                rm->used[i] ^= zobrist_unit[i][n - 1];
+            else
+                rm->empty[i]++;
+        }
+        if (rm->empty[i])
+            rm->hash ^= rm->used[i];
+    }
+
+    rm->cells = 0;
+    for (i = 0; i < 81; i++)
+        if (!p[i])
+        {
+            rm->hash ^= zobrist[i][0];
+            rm->cells++;
+        }
+}
+
+/* Account for position x changing from value old to value n, where 0 
+ * stands for an empty cell.
+ */
+void
+remainder_set (struct remainder *rm, int8_t x, int8_t old, int8_t n)
+{
+    int8_t i;
+
+    if (old == n)
+        return;
+
+    if (!old || !n)
+    {
+        rm->hash ^= zobrist[x][0];
+        rm->cells += old ? 1 : -1;
+    }
+
+    for (i = 0; i < layout.nmember[x]; i++)
+    {
+        int8_t   u = layout.member[x][i];
+        uint64_t before = rm->empty[u] ? rm->used[u] : 0;
+
+        if (old)
+            rm->used[u] ^= zobrist_unit[u][old - 1];
+        else
+            rm->empty[u]--;
+
+        if (n)
+            rm->used[u] ^= zobrist_unit[u][n - 1];
+        else
+            rm->empty[u]++;
+
+        rm->hash ^= before ^ (rm->empty[u] ? rm->used[u] : 0);
+    }
+}
+
+/* Allocate a table of at most the given size in bytes. Return 0 on failure. */
+int
+tt_init (struct ttable *t, size_t bytes)
+{
+    size_t n = 1;
+
+    while (n <= bytes / (2 * sizeof (uint64_t)))
+        n *= 2;
+
+    t->slots = calloc (n, sizeof (uint64_t));
+    t->mask = n - 1;
+    atomic_init (&t->hits, 0);
+
+    return NULL != t->slots;
+}
+
+void
+tt_free (struct ttable *t)
+{
+    free ((void *) t->slots);
+    t->slots = NULL;
+}
+
+/* Zero marks an empty slot, so stored hashes always have the low bit set. */
+void
+tt_store (struct ttable *t, uint64_t h)
+{
+    uint64_t i;
+
+    h |= 1;
+
+    for (i = 0; i < TT_PROBE; i++)
+    {
+        _Atomic uint64_t *s = &t->slots[(h + i) & t->mask];
+        uint64_t v = atomic_load_explicit (s, memory_order_relaxed);
+
+        if (v == h)
+            return;
+        if (0 == v)
+        {
+            atomic_store_explicit (s, h, memory_order_relaxed);
+            return;
+        }
+    }
+
+    atomic_store_explicit (&t->slots[h & t->mask], h, memory_order_relaxed);
+}
+
+/* Probes which miss cost a cache miss each. Where fewer than one in 
+ * TT_SAMPLE probes hit, only one in TT_SAMPLE chances to probe is taken,
+ * to keep the hit rate measured.
+ */
+#define TT_SAMPLE 64
+
+struct probe_rate
+{
+    long chances;
+    long probes;
+    long hits;
+};
+
+int
+tt_should_probe (struct probe_rate *r)
+{
+    if (r->hits * TT_SAMPLE < r->probes && 0 != ++r->chances % TT_SAMPLE)
+        return 0;
+
+    r->probes++;
+    return 1;
+}
+
+int
+tt_dead (struct ttable *t, uint64_t h)
+{
+    uint64_t i;
+
+    h |= 1;
+
+    for (i = 0; i < TT_PROBE; i++)
+    {
+        if (h == atomic_load_explicit (&t->slots[(h + i) & t->mask], memory_order_relaxed))
+        {
+            atomic_fetch_add_explicit (&t->hits, 1, memory_order_relaxed);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* Solve a puzzle using candidate propagation followed by the brute-force
+ * search, stopping after the given number of solutions has been found; the
+ * number found is stored in count. The grid is modified in place, and holds
+ * the last solution found. 
+ *
+ * Propagation and search follow the configuration, except that the clause
+ * learning engine is not used for counting. The budget and the 
+ * transposition table are optional. If the budget sets cdcl_after, 
+ * a search for a single solution which takes longer than that is restarted 
+ * from the propagated grid with cdcl_run ().
+ *
+ * Return codes:
+ *
+ *    1 : At least one solution found.
+ *   -1 : No solution exists.
+ *    2 : The budget was exhausted, or the puzzle was cancelled.
+ */
+int
+solve_count (int8_t *p, const struct config *cfg, struct budget *b, 
+             struct ttable *tt, long limit, long *count)
+{
+    int16_t  candidates[81];
+    int8_t   base[81],
+             last[81],
+             order[81];
+    int8_t   cursor = -2;
+    long     entry[81],         /* Solutions found when a cell was entered */
+             entry_nodes[81],   /* Nodes searched when a cell was entered */
+             nodes = 0;
+    uint64_t clues = 0;
+    struct remainder rm;
+    struct probe_rate rate[82];     /* Indexed by the number of empty cells */
+    enum state state = STATE_FORWARD;
+    int r = 0;
+
+    *count = 0;
+
+    if (b)
+        budget_start (b);
+
+    if (tt)
+        clues = board_hash (p);
+
+    perf_switch (PHASE_INIT);
+
+    if (REPR_PLANES == cfg->repr)
+    {
+        struct planes s;
+
+        planes_init (p, &s);
+        perf_switch (PHASE_SATURATE);
+
+        do
+        {
+            if (b)
+                b->saturations++;
+            if (budget_spent (b, 1))
+                return 2;
+        } while (saturate_planes (p, &s));
+
+        if (planes_empty (&s))
+            return -1;
+
+        planes_to_candidates (&s, candidates);
+    }
+    else
+    {
+        init_candidates (p, candidates);
+        perf_switch (PHASE_SATURATE);
+
+        do
+        {
+            if (b)
+                b->saturations++;
+            if (budget_spent (b, 1))
+                return 2;
+        } while (saturate_with (p, candidates, cfg->techniques));
+
+        if (cells_contradiction (p, candidates))
+            return -1;
+    }
+
+    perf_switch (PHASE_SEARCH);
+
+    if (cfg->mrv)
+    {
+        int8_t i, k, n = 0;
+
+        for (k = 2; k <= 9; k++)
+            for (i = 0; i < 81; i++)
+                if (k == (candidates[i] & 0b1111))
+                    order[n++] = i;
+        for (i = 0; i < 81; i++)
+            if (2 > (candidates[i] & 0b1111))
+                order[n++] = i;
+    }
+
+    memcpy (base, p, 81);
+
+    if (tt)
+    {
+        remainder_init (&rm, p, clues);
+        memset (rate, 0, sizeof (rate));
+    }
+
+    for (;;)
+    {
+        int8_t c = cursor, 
+               x = 0,
+               old = 0;
+        enum state prev = state;
+
+        nodes++;
+        if (b)
+            b->nodes++;
+        if (budget_spent (b, 0))
+            return 2;
+
+        if (1 == limit && b && b->cdcl_after && b->nodes > b->cdcl_after)
+        {
+            memcpy (p, base, 81);
+            return cdcl_run (p, candidates, b);
+        }
+
+        if (0 <= c && c < 81)
+        {
+            x = cfg->mrv ? order[c] : c;
+            old = p[x];
+        }
+
+        r = step (p, candidates, cfg->mrv ? order : NULL, &cursor, &state);
+
+        if (1 == r)
+        {
+            if (++*count >= limit)
+                return 1;
+
+            /* Resume the search from the last cell */
+            memcpy (last, p, 81);
+            cursor = 81;
+            state = STATE_REVERSE;
+            continue;
+        }
+        if (-1 == r)
+        {
+            if (!*count)
+                return -1;
+            memcpy (p, last, 81);
+            return 1;
+        }
+
+        if (!tt)
+            continue;
+
+        if (STATE_FORWARD == prev && STATE_EVAL == state)
+        {
+            entry[cursor] = *count;
+            entry_nodes[cursor] = nodes;
+        }
+
+        if (STATE_EVAL != prev)
+            continue;
+
+        remainder_set (&rm, x, old, p[x]);
+
+        if (STATE_REVERSE == state)
+        {
+            /* Every value of the cell has been tried on this remainder */
+            if (entry[c] == *count && nodes - entry_nodes[c] >= TT_MIN_NODES)
+                tt_store (tt, rm.hash);
+        }
+        else if (tt_should_probe (&rate[rm.cells]) && tt_dead (tt, rm.hash))
+        {
+            rate[rm.cells].hits++;
+            /* Known dead end; go on with the next value of the cell */
+            state = STATE_EVAL;
+        }
+    }
+}
+
+/* Solve a puzzle, as solve_count () with a limit of one solution, or with
+ * the clause learning engine if the configuration asks for it.
+ */
+int
+solve (int8_t *p, const struct config *cfg, struct budget *b, struct ttable *tt)
+{
+    long count;
+
+    if (cfg->cdcl)
+        return solve_cdcl (p, b);
+
+    return solve_count (p, cfg, b, tt, 1, &count);
+}
+
+/* === Lane-parallel propagation ==============================================
+ *
+ * The lane engine propagates up to LANES puzzles at once. Candidate state is
+ * kept bitsliced, in a struct-of-arrays layout: bit k of plane[p][n] is set
+ * if n + 1 is a candidate at position p in puzzle k. A single bitwise
+ * operation on a plane word thus advances the same deduction in every
+ * puzzle of the batch.
+ *
+ * Only singleton elimination and hidden singles are run in this form.
+ * Puzzles which are not solved by propagation alone are handed back to the
+ * scalar path, together with the values deduced so far.
+ */
+#define LANES 16
+
+typedef uint16_t lane_t;
+
+struct lanes
+{
+    lane_t plane[81][9];
+    lane_t solved[81];      /* Lanes in which the cell is resolved */
+    lane_t active;          /* Lanes holding a puzzle */
+    lane_t dead;            /* Lanes in which a contradiction was found */
+};
+
+void
+lanes_load (struct lanes *l, int8_t *puzzles, int8_t n)
+{
+    int8_t i, j, k;
+
+    memset (l, 0, sizeof (struct lanes));
+
+    for (k = 0; k < n; k++)
+    {
+        int8_t *p = puzzles + k * 81;
+
+        for (i = 0; i < 81; i++)
+            for (j = 0; j < 9; j++)
+                if (0 == p[i] || j + 1 == p[i])
+                    l->plane[i][j] |= (1 << k);
+
+        l->active |= (1 << k);
+    }
+}
+
+int
+lanes_propagate (struct lanes *l)
+{
+    int8_t i, j, k, n;
+    lane_t ones, twos, x, m;
+    int f, changed = 0;
+
+    do
+    {
+        f = 0;
+
+        /* === Singleton elimination ==========================================
+         *
+         * Count the candidates of each cell across all lanes at once, using
+         * a saturating two-bit counter per lane. Lanes in which exactly one
+         * candidate remains have that value removed from all peers.
+         */
+        for (i = 0; i < 81; i++)
+        {
+            ones = twos = 0;
+            for (j = 0; j < 9; j++)
+            {
+                twos |= ones & l->plane[i][j];
+                ones |= l->plane[i][j];
+            }
+
+            l->dead |= l->active & ~ones;
+
+            x = ones & ~twos & ~l->solved[i] & l->active;
+            if (!x)
+                continue;
+
+            l->solved[i] |= x;
+            f = 1;
+
+            for (j = 0; j < 9; j++)
+            {
+                m = l->plane[i][j] & x;
+                if (m)
+                    for (k = 0; k < layout.npeers[i]; k++)
+                        l->plane[layout.peers[i][k]][j] &= ~m;
+            }
+        }
+
+        /* === Hidden singles =================================================
+         *
+         * A value which fits only one cell of a unit is assigned to it.
+         * Lanes in which a value fits no cell at all are contradictions.
+         */
+        for (i = 0; i < layout.nunits; i++)
+        {
+            for (j = 0; j < 9; j++)
+            {
+                ones = twos = 0;
+                for (k = 0; k < 9; k++)
+                {
+                    x = l->plane[layout.unit[i][k]][j];
+                    twos |= ones & x;
+                    ones |= x;
+                }
+
+                l->dead |= l->active & ~ones;
+
+                x = ones & ~twos & l->active;
+                if (!x)
+                    continue;
+
+                for (k = 0; k < 9; k++)
+                {
+                    int8_t o = layout.unit[i][k];
+
+                    m = l->plane[o][j] & x;
+                    if (!m)
+                        continue;
+
+                    for (n = 0; n < 9; n++)
+                    {
+                        if (n != j && (l->plane[o][n] & m))
+                        {
+                            l->plane[o][n] &= ~m;
+                            f = 1;
+                        }
+                    }
+                }
+            }
+        }
+
+        changed |= f;
+
+    } while (f && (l->active & ~l->dead));
+
+    return changed;
+}
+
+/* Write the values deduced for lane k back to a grid.
+ *
+ * Return codes:
+ *
+ *    0 : Propagation incomplete; some cells remain empty.
+ *    1 : The grid is solved.
+ *   -1 : A contradiction was found in this lane.
+ */
+int
+lanes_store (struct lanes *l, int8_t k, int8_t *p)
+{
+    int8_t i, j;
+    lane_t b = 1 << k;
+    int r = 1;
+
+    if (l->dead & b)
+        return -1;
+
+    for (i = 0; i < 81; i++)
+    {
+        p[i] = 0;
+        if (l->solved[i] & b)
+        {
+            for (j = 0; j < 9; j++)
+                if (l->plane[i][j] & b)
+                    p[i] = j + 1;
+        }
+        else
+        {
+            r = 0;
+        }
+    }
+
+    return r;
+}
+
+/* Solve n puzzles, LANES at a time. Puzzles which propagation alone does not
+ * settle fall back to solve (). The result of each puzzle is stored in r.
+ */
+void
+solve_lanes (int8_t *puzzles, int n, int *r, const struct config *cfg, 
+             struct budget *b, struct ttable *tt)
+{
+    struct lanes l;
+    int i;
+    int8_t k, w;
+
+    for (i = 0; i < n; i += LANES)
+    {
+        w = (n - i < LANES) ? n - i : LANES;
+
+        perf_switch (PHASE_INIT);
+        lanes_load (&l, puzzles + i * 81, w);
+        perf_switch (PHASE_SATURATE);
+        lanes_propagate (&l);
+        perf_switch (PHASE_NONE);
+
+        for (k = 0; k < w; k++)
+        {
+            int8_t *p = puzzles + (i + k) * 81;
+
+            r[i + k] = lanes_store (&l, k, p);
+            if (0 == r[i + k])
+            {
+                r[i + k] = solve (p, cfg, b, tt);
+                perf_switch (PHASE_NONE);
+            }
+        }
+    }
+}
+
+/* === Portfolio ==============================================================
+ *
+ * No single configuration is the fastest on every puzzle. In portfolio
+ * mode, each configuration of the list below runs on a thread of its own,
+ * on a copy of the puzzle. The first to reach a verdict cancels the others
+ * through the lost flag of their budgets, and its index is reported so
+ * that the list can be reordered according to which configurations win.
+ */
+#define PORTFOLIO_SIZE 5
+
+const struct config portfolio[PORTFOLIO_SIZE] =
+{
+    { "cells",        REPR_CELLS,  0, 0, 0 },
+    { "planes",       REPR_PLANES, 0, 0, 0 },
+    { "planes-mrv",   REPR_PLANES, 0, 1, 0 },
+    { "cells-chains", REPR_CELLS,  0, 0, TECH_ALL },
+    { "cdcl",         REPR_CELLS,  1, 0, 0 }
+};
+
+struct racer
+{
+    const struct config *cfg;
+    int8_t         p[81];
+    struct budget  b;
+    struct ttable *tt;
+    atomic_int    *winner;
+    struct perf   *report;      /* Counters of the caller, or NULL */
+    int            index;
+    int            r;
+};
+
+void *
+race (void *arg)
+{
+    struct racer *x = arg;
+    struct perf   counters;
+    int none = -1;
+
+    if (x->report && perf_open (&counters))
+        perf = &counters;
+
+    x->r = solve (x->p, x->cfg, &x->b, x->tt);
+    perf_switch (PHASE_NONE);
+
+    if (2 != x->r && atomic_compare_exchange_strong (x->winner, &none, x->index))
+    {
+        atomic_store (x->b.lost, 1);
+        if (perf)
+            perf_add (x->report, perf);
+    }
+
+    if (perf)
+    {
+        perf_close (perf);
+        perf = NULL;
+    }
+
+    return NULL;
+}
+
+/* Solve a puzzle with every configuration of the portfolio at once. The 
+ * limits apply to each configuration separately, and the cancel flag of the
+ * caller, if any, stops all of them; the racers are stopped by the winner 
+ * through a flag of their own. The transposition table, if any, is shared
+ * as well. If the caller counts hardware events, each racer counts its own
+ * and those of the winner are added to the caller's. The index of the 
+ * winning configuration, or -1 if none finished, is stored in winner.
+ *
+ * Return codes are those of solve ().
+ */
+int
+solve_portfolio (int8_t *p, const struct budget *limits, struct ttable *tt, int *winner)
+{
+    struct racer racers[PORTFOLIO_SIZE];
+    pthread_t    threads[PORTFOLIO_SIZE];
+    int          started[PORTFOLIO_SIZE];
+    atomic_int   lost, won;
+    int i, w;
+
+    atomic_init (&lost, 0);
+    atomic_init (&won, -1);
+
+    for (i = 0; i < PORTFOLIO_SIZE; i++)
+    {
+        racers[i].cfg = &portfolio[i];
+        memcpy (racers[i].p, p, 81);
+        racers[i].b = *limits;
+        racers[i].b.lost = &lost;
+        racers[i].tt = tt;
+        racers[i].winner = &won;
+        racers[i].report = perf;
+        racers[i].index = i;
+        racers[i].r = 2;
+
+        started[i] = !pthread_create (&threads[i], NULL, race, &racers[i]);
+    }
+
+    for (i = 0; i < PORTFOLIO_SIZE; i++)
+        if (started[i])
+            pthread_join (threads[i], NULL);
+
+    *winner = w = atomic_load (&won);
+
+    if (-1 == w)
+        return 2;
+
+    memcpy (p, racers[w].p, 81);
+
+    return racers[w].r;
+}
+
+/* === Incremental play =======================================================
+ *
+ * For interactive use, a board keeps the set of values placed in each unit.
+ * The candidates of an empty cell are then the values used by none of its 
+ * units, so that placing or erasing a value only requires the cell and its
+ * peers to be brought up to date. Since candidates are always derived from
+ * the placed values, erasing restores them without any undo information.
+ *
+ * The candidate matrix of a board follows the layout described above
+ * init_candidates (), and reflects placed values only; deductions are left
+ * to board_hint ().
+ */
+struct board
+{
+    int8_t  d[81];
+    int16_t used[MAX_UNITS];        /* 9-bit sets of placed values */
+    int16_t candidates[81];
+};
+
+enum hint_kind
+{
+    HINT_NONE,                      /* No single found */
+    HINT_SOLVED,
+    HINT_NAKED_SINGLE,              /* Only one value fits the cell */
+    HINT_HIDDEN_SINGLE,             /* The value fits only one cell of the unit */
+    HINT_EMPTY_CELL,                /* Contradiction: no value fits the cell */
+    HINT_MISSING_VALUE              /* Contradiction: the value fits nowhere in the unit */
+};
+
+struct hint
+{
+    enum hint_kind kind;
+    int8_t pos;
+    int8_t value;
+    int8_t unit;
+};
+
+void
+board_update (struct board *bd, int8_t pos)
+{
+    int8_t  i;
+    int16_t bits = 0;
+
+    if (bd->d[pos])
+    {
+        bd->candidates[pos] = 1 | (1 << (bd->d[pos] + 3));
+        return;
+    }
+
+    for (i = 0; i < layout.nmember[pos]; i++)
+        bits |= bd->used[layout.member[pos][i]];
+
+    bits = ~bits & 0x1ff;
+    bd->candidates[pos] = bitcount (bits) | (bits << 4);
+}
+
+/* Return 0 if the givens conflict. */
+int
+board_init (struct board *bd, const int8_t *p)
+{
+    int8_t i, j;
+    int ok = 1;
+
+    memset (bd, 0, sizeof (struct board));
+    memcpy (bd->d, p, 81);
+
+    for (i = 0; i < layout.nunits; i++)
+    {
+        for (j = 0; j < 9; j++)
+        {
+            int8_t n = p[layout.unit[i][j]];
+
+            if (!n)
+                continue;
+            if (bd->used[i] & (1 << (n - 1)))
+                ok = 0;
+            bd->used[i] |= (1 << (n - 1));
+        }
+    }
+
+    for (i = 0; i < 81; i++)
+        board_update (bd, i);
+
+    return ok;
+}
+
+/* Place a value in an empty cell. Return 0, leaving the board unchanged, if
+ * the cell is taken or the value is already used by one of its units.
+ */
+int
+board_place (struct board *bd, int8_t pos, int8_t n)
+{
+    int8_t i;
+
+    if (bd->d[pos] || !IS_CANDIDATE (bd->candidates, pos, n))
+        return 0;
+
+    bd->d[pos] = n;
+    for (i = 0; i < layout.nmember[pos]; i++)
+        bd->used[layout.member[pos][i]] |= (1 << (n - 1));
+
+    board_update (bd, pos);
+    for (i = 0; i < layout.npeers[pos]; i++)
+        board_update (bd, layout.peers[pos][i]);
+
+    return 1;
+}
+
+/* Erase the value of a cell, restoring the candidates of its peers. */
+void
+board_erase (struct board *bd, int8_t pos)
+{
+    int8_t i, 
+           n = bd->d[pos];
+
+    if (!n)
+        return;
+
+    bd->d[pos] = 0;
+    for (i = 0; i < layout.nmember[pos]; i++)
+        bd->used[layout.member[pos][i]] &= ~(1 << (n - 1));
+
+    board_update (bd, pos);
+    for (i = 0; i < layout.npeers[pos]; i++)
+        board_update (bd, layout.peers[pos][i]);
+}
+
+/* Find the next logical step from the current board: a contradiction if
+ * there is one, otherwise a naked or a hidden single.
+ */
+void
+board_hint (const struct board *bd, struct hint *h)
+{
+    int8_t  i, j, k, pos = -1;
+    int     solved = 1;
+
+    memset (h, 0, sizeof (struct hint));
+    h->pos = h->unit = -1;
+
+    for (i = 0; i < 81; i++)
+    {
+        if (bd->d[i])
+            continue;
+
+        solved = 0;
+
+        if (0 == (bd->candidates[i] & 0b1111))
+        {
+            h->kind = HINT_EMPTY_CELL;
+            h->pos = i;
+            return;
+        }
+        if (-1 == pos && 1 == (bd->candidates[i] & 0b1111))
+            pos = i;
+    }
+
+    if (solved)
+    {
+        h->kind = HINT_SOLVED;
+        return;
+    }
+
+    for (i = 0; i < layout.nunits; i++)
+    {
+        for (j = 1; j <= 9; j++)
+        {
+            int8_t n = 0, o = -1;
+
+            if (bd->used[i] & (1 << (j - 1)))
+                continue;
+
+            for (k = 0; k < 9; k++)
+            {
+                if (IS_CANDIDATE (bd->candidates, layout.unit[i][k], j))
+                {
+                    n++;
+                    o = layout.unit[i][k];
+                }
+            }
+
+            if (0 == n)
+            {
+                h->kind = HINT_MISSING_VALUE;
+                h->unit = i;
+                h->value = j;
+                return;
+            }
+            if (1 == n && -1 == h->pos && -1 == pos)
+            {
+                h->kind = HINT_HIDDEN_SINGLE;
+                h->pos = o;
+                h->unit = i;
+                h->value = j;
+            }
+        }
+    }
+
+    if (-1 != pos)
+    {
+        h->kind = HINT_NAKED_SINGLE;
+        h->pos = pos;
+        h->value = log2_plus1 (bd->candidates[pos] >> 4);
+    }
+}
+
+void
+tests ()
+{
+    int16_t candidates[81];
+    int f;
+
+    /*                xxxx987654321ssss */
+    candidates[0] = 0b00000000000100001;
+    candidates[1] = 0b00001010010000011;
+    candidates[2] = 0b00000000100000001;
+    candidates[3] = 0b00001110010010101;
+    candidates[4] = 0b00001010010000011;
+    candidates[5] = 0b00001110010010101;
+    candidates[6] = 0b00000000001000001;
+    candidates[7] = 0b00001010010000011;
+    candidates[8] = 0b00000001000000001;
+
+    remove_hidden_subset (candidates, 0, 2, &f);
+
+    assert (0b00000000000100001 == candidates[0]);
+    assert (0b00001010010000011 == candidates[1]);
+    assert (0b00000000100000001 == candidates[2]);
+    assert (0b00000100000010010 == candidates[3]);
+    assert (0b00001010010000011 == candidates[4]);
+    assert (0b00000100000010010 == candidates[5]);
+    assert (0b00000000001000001 == candidates[6]);
+    assert (0b00001010010000011 == candidates[7]);
+    assert (0b00000001000000001 == candidates[8]);
+
+    /*                xxxx987654321ssss */
+    candidates[0] = 0b00000000100110011;
+    candidates[1] = 0b00000001101010100;
+    candidates[2] = 0b00000100000000001;
+    candidates[3] = 0b00000000010000001;
+    candidates[4] = 0b00000011100010100;
+    candidates[5] = 0b00001011000000011;
+    candidates[6] = 0b00000010000100010;
+    candidates[7] = 0b00000011000000010;
+    candidates[8] = 0b00001011000000011;
+
+    remove_hidden_subset (candidates, 0, 1, &f);
+
+    assert (candidates[0] == 0b00000000100110011);
+    assert (candidates[1] == 0b00000000001000001);
+    assert (candidates[2] == 0b00000100000000001);
+    assert (candidates[3] == 0b00000000010000001);
+    assert (candidates[4] == 0b00000011100010100);
+    assert (candidates[5] == 0b00001011000000011);
+    assert (candidates[6] == 0b00000010000100010);
+    assert (candidates[7] == 0b00000011000000010);
+    assert (candidates[8] == 0b00001011000000011);
+}
+
+void
+tests2 ()
+{
+    /*
+    {
+        int16_t candidates[81];
+    
+        int8_t p[] = 
+        {
+            0,0,0, 0,0,2, 0,0,0,
+            0,8,0, 0,6,0, 0,1,0,
+            2,0,6, 0,0,0, 5,0,9,
+    
+            0,0,8, 0,0,0, 0,0,2,
+            0,1,0, 0,8,0, 0,7,0,
+            5,0,0, 0,0,0, 1,0,0,
+    
+            3,0,1, 0,0,0, 9,0,5,
+            0,4,0, 0,7,0, 0,6,0,
+            0,0,0, 1,0,0, 0,0,0
+        };
+    
+        init_candidates (p, candidates);
+    
+        while (saturate (p, candidates))
+            printf ("-\n");
+    
+        {
+            int8_t r, cursor = -2;
+            enum state state = STATE_FORWARD;
+    
+            r = 0;
+            while (0 == r)
+                r = step (p, candidates, NULL, &cursor, &state);
+        }
+    
+        dump (p);
+    }
+    {
+        int16_t candidates[81];
+    
+        int8_t p[] = 
+        {
+            8,0,0, 0,0,0, 0,0,0,
+            0,0,3, 6,0,0, 0,0,0,
+            0,7,0, 0,9,0, 2,0,0,
+    
+            0,5,0, 0,0,7, 0,0,0,
+            0,0,0, 0,4,5, 7,0,0,
+            0,0,0, 1,0,0, 0,3,0,
 
             0,0,1, 0,0,0, 0,6,8,
             0,0,8, 5,0,0, 0,1,0,
@@ -772,90 +3188,921 @@ tests2 ()
             printf ("-\n");
     
         {
-            int8_t r, cursor = -2;
-            enum state state = STATE_FORWARD;
-    
-            r = 0;
-            while (0 == r)
-                r = step (p, candidates, &cursor, &state);
+            int8_t r, cursor = -2;
+            enum state state = STATE_FORWARD;
+    
+            r = 0;
+            while (0 == r)
+                r = step (p, candidates, NULL, &cursor, &state);
+        }
+    
+        dump (p);
+    }
+    {
+        int16_t candidates[81];
+    
+        int8_t p[] = 
+        {
+            7,0,0, 0,0,0, 4,0,0,
+            0,2,0, 0,7,0, 0,8,0,
+            0,0,3, 0,0,8, 0,0,9,
+    
+            0,0,0, 5,0,0, 3,0,0,
+            0,6,0, 0,2,0, 0,9,0,
+            0,0,1, 0,0,7, 0,0,6,
+
+            0,0,0, 3,0,0, 9,0,0,
+            0,3,0, 0,4,0, 0,6,0,
+            0,0,9, 0,0,1, 0,3,5
+        };
+    
+        init_candidates (p, candidates);
+    
+        while (saturate (p, candidates))
+            printf ("-\n");
+    
+        {
+            int8_t r, cursor = -2;
+            enum state state = STATE_FORWARD;
+    
+            r = 0;
+            while (0 == r)
+                r = step (p, candidates, NULL, &cursor, &state);
+        }
+    
+        dump (p);
+    }
+    */
+    {
+        int16_t candidates[81];
+    
+        int8_t p[] = 
+        {
+            5,3,0, 0,7,0, 0,0,0,
+            6,0,0, 1,9,5, 0,0,0,
+            0,9,8, 0,0,0, 0,6,0,
+    
+            8,0,0, 0,6,0, 0,0,3,
+            4,0,0, 8,0,3, 0,0,1,
+            7,0,0, 0,2,0, 0,0,6,
+
+            0,6,0, 0,0,0, 2,8,0,
+            0,0,0, 4,1,9, 0,0,5,
+            0,0,0, 0,8,0, 0,7,9 
+        };
+    
+        init_candidates (p, candidates);
+    
+        while (saturate (p, candidates))
+            printf ("-\n");
+    
+        {
+            int8_t r, cursor = -2;
+            enum state state = STATE_FORWARD;
+    
+            r = 0;
+            while (0 == r)
+                r = step (p, candidates, NULL, &cursor, &state);
+        }
+    
+        dump (p);
+    }
+}
+
+void
+tests5 ()
+{
+    int    r;
+    int8_t i;
+    int8_t q[81];
+
+    int8_t p[] = 
+    {
+        5,3,0, 0,7,0, 0,0,0,
+        6,0,0, 1,9,5, 0,0,0,
+        0,9,8, 0,0,0, 0,6,0,
+
+        8,0,0, 0,6,0, 0,0,3,
+        4,0,0, 8,0,3, 0,0,1,
+        7,0,0, 0,2,0, 0,0,6,
+
+        0,6,0, 0,0,0, 2,8,0,
+        0,0,0, 4,1,9, 0,0,5,
+        0,0,0, 0,8,0, 0,7,9 
+    };
+
+    r = solve_cdcl (p, NULL);
+    assert (1 == r);
+    for (i = 0; i < 81; i++)
+        assert (p[i] && validate_pos (p, i));
+
+    /* Both ends of row 1 can only take 1; the clause for 1 appearing at
+     * most once in the row must make the solver report no solution. */
+    memset (q, 0, sizeof (q));
+    for (i = 1; i < 9; i++)
+    {
+        q[i * 9] = i + 1;
+        q[i * 9 + 8] = i % 8 + 2;
+    }
+
+    r = solve_cdcl (q, NULL);
+    assert (-1 == r);
+    (void) r;
+}
+
+void
+tests6 ()
+{
+    int16_t  candidates[81], eff[81];
+    cellmask plane[9];
+    int8_t   d[81], i;
+    int      f;
+
+    memset (d, 0, sizeof (d));
+
+    /* XY-Wing: pivot {1, 2} at r1c1, pincers {1, 3} at r1c5 and {2, 3} at 
+     * r5c1; r5c5 sees both pincers and loses 3.
+     */
+    for (i = 0; i < 81; i++)
+        candidates[i] = 0b00001111111111001;
+    /*                xxxx987654321ssss */
+    candidates[0]  = 0b00000000000110010;
+    candidates[4]  = 0b00000000001010010;
+    candidates[36] = 0b00000000001100010;
+
+    chain_view (d, candidates, eff, plane);
+    f = remove_xy_wing (candidates, eff, plane);
+
+    assert (f);
+    assert (0b00001111110111000 == candidates[40]);
+    for (i = 0; i < 81; i++)
+        assert (40 == i || 3 > (candidates[i] & 0b1111) || 0b00001111111111001 == candidates[i]);
+
+    /* XYZ-Wing: pivot {1, 2, 3} at r1c1, pincers {1, 3} at r1c2 and {2, 3}
+     * at r2c1; the rest of the first box loses 3.
+     */
+    for (i = 0; i < 81; i++)
+        candidates[i] = 0b00001111111111001;
+    /*                xxxx987654321ssss */
+    candidates[0]  = 0b00000000001110011;
+    candidates[1]  = 0b00000000001010010;
+    candidates[9]  = 0b00000000001100010;
+
+    chain_view (d, candidates, eff, plane);
+    f = remove_xyz_wing (candidates, eff, plane);
+
+    assert (f);
+    assert (0b00001111110111000 == candidates[2]);
+    assert (0b00001111110111000 == candidates[20]);
+    assert (0b00001111111111001 == candidates[3]);
+    assert (0b00001111111111001 == candidates[27]);
+
+    /* Coloring: 1 is left twice in row 1 (r1c1, r1c5), column 5 (r1c5, 
+     * r4c5) and row 4 (r4c5, r4c1). r1c1 and r4c1 take opposite colors, so
+     * the rest of the first column loses 1.
+     */
+    for (i = 0; i < 81; i++)
+        candidates[i] = 0b00001111111111001;
+    for (i = 0; i < 9; i++)
+    {
+        if (0 != i && 4 != i)
+            CLEAR_CANDIDATE (candidates, i, 1);
+        if (0 != i && 3 != i)
+            CLEAR_CANDIDATE (candidates, i * 9 + 4, 1);
+        if (0 != i && 4 != i)
+            CLEAR_CANDIDATE (candidates, 27 + i, 1);
+    }
+
+    chain_view (d, candidates, eff, plane);
+    f = remove_coloring (candidates, eff, plane);
+
+    assert (f);
+    for (i = 1; i < 9; i++)
+        assert ((3 == i) == !!IS_CANDIDATE (candidates, i * 9, 1));
+    assert (IS_CANDIDATE (candidates, 0, 1));
+    assert (IS_CANDIDATE (candidates, 4, 1));
+    assert (IS_CANDIDATE (candidates, 31, 1));
+    assert (IS_CANDIDATE (candidates, 10, 1));
+    (void) f;
+}
+
+void
+tests3 ()
+{
+    struct board bd;
+    struct hint  h;
+    int16_t candidates[81];
+    int     ok;
+
+    int8_t p[] = 
+    {
+        5,3,0, 0,7,0, 0,0,0,
+        6,0,0, 1,9,5, 0,0,0,
+        0,9,8, 0,0,0, 0,6,0,
+
+        8,0,0, 0,6,0, 0,0,3,
+        4,0,0, 8,0,3, 0,0,1,
+        7,0,0, 0,2,0, 0,0,6,
+
+        0,6,0, 0,0,0, 2,8,0,
+        0,0,0, 4,1,9, 0,0,5,
+        0,0,0, 0,8,0, 0,7,9 
+    };
+
+    init_candidates (p, candidates);
+    ok = board_init (&bd, p);
+    assert (ok);
+    assert (!memcmp (candidates, bd.candidates, sizeof (candidates)));
+
+    /* Placing and erasing a value restores the candidates of all peers */
+    ok = board_place (&bd, 2, 4);
+    assert (ok);
+    assert (!IS_CANDIDATE (bd.candidates, 1, 4));
+    ok = board_place (&bd, 1, 4);
+    assert (!ok);
+    board_erase (&bd, 2);
+    assert (!memcmp (candidates, bd.candidates, sizeof (candidates)));
+
+    /* Following hints solves the puzzle */
+    for (board_hint (&bd, &h); HINT_NAKED_SINGLE == h.kind || HINT_HIDDEN_SINGLE == h.kind; board_hint (&bd, &h))
+    {
+        ok = board_place (&bd, h.pos, h.value);
+        assert (ok);
+    }
+    assert (HINT_SOLVED == h.kind);
+
+    /* A contradiction is reported */
+    board_init (&bd, p);
+    board_place (&bd, 2, 1);
+    board_place (&bd, 3 * 9 + 2, 2);
+    board_place (&bd, 6 * 9 + 2, 3);
+    board_place (&bd, 7 * 9 + 2, 6);
+    board_hint (&bd, &h);
+    assert (HINT_EMPTY_CELL == h.kind || HINT_MISSING_VALUE == h.kind);
+    (void) ok;
+}
+
+/* Parse a puzzle given as a line of 81 characters, where empty cells are
+ * written as '0' or '.'. Return 1 on success.
+ */
+int
+read_puzzle (const char *line, int8_t *p)
+{
+    int8_t i;
+
+    for (i = 0; i < 81; i++)
+    {
+        if ('1' <= line[i] && line[i] <= '9')
+            p[i] = line[i] - '0';
+        else if ('0' == line[i] || '.' == line[i])
+            p[i] = 0;
+        else
+            return 0;
+    }
+
+    return 1;
+}
+
+/* === Triage =================================================================
+ *
+ * Cheap checks run on every record before it is handed to a solver, so 
+ * that garbage is rejected up front instead of costing a full search. 
+ * Clues are collected into per-unit sets of used values, as in struct 
+ * board. A first pass over the cells derives each candidate set and 
+ * collects, per unit, the values forced by cells with a single candidate.
+ * A second pass, one round of propagation, clears the forced values from
+ * the other cells of their units and accumulates, for every unit, the 
+ * values which are still placed or possible somewhere in it. This finds:
+ *
+ *   - records which are not 81 digits or dots;
+ *   - a value given twice in a unit;
+ *   - two cells of a unit forced to the same value;
+ *   - an empty cell that no value fits;
+ *   - a unit in which some value fits nowhere.
+ *
+ * The grid itself is left as given. Passing triage does not imply that a
+ * solution exists.
+ */
+enum triage
+{
+    TRIAGE_OK,
+    TRIAGE_MALFORMED,
+    TRIAGE_DUPLICATE_CLUE,
+    TRIAGE_FORCED_TWICE,
+    TRIAGE_EMPTY_CELL,
+    TRIAGE_MISSING_VALUE
+};
+
+const char *
+triage_reason (enum triage t)
+{
+    switch (t)
+    {
+        case TRIAGE_OK:             return "ok";
+        case TRIAGE_MALFORMED:      return "malformed";
+        case TRIAGE_DUPLICATE_CLUE: return "duplicate clue";
+        case TRIAGE_FORCED_TWICE:   return "value forced twice";
+        case TRIAGE_EMPTY_CELL:     return "empty cell";
+        case TRIAGE_MISSING_VALUE:  return "missing value";
+    }
+    return "";
+}
+
+enum triage
+triage (const char *line, int8_t *p)
+{
+    int16_t used[MAX_UNITS],
+            forced[MAX_UNITS],
+            seen[MAX_UNITS],
+            cand[81],
+            bits;
+    int8_t  i, j;
+
+    if (!read_puzzle (line, p))
+        return TRIAGE_MALFORMED;
+    for (line += 81; *line; line++)
+        if (!isspace ((unsigned char) *line))
+            return TRIAGE_MALFORMED;
+
+    memset (used, 0, sizeof (used));
+    memset (forced, 0, sizeof (forced));
+    memset (seen, 0, sizeof (seen));
+
+    for (i = 0; i < layout.nunits; i++)
+    {
+        for (j = 0; j < 9; j++)
+        {
+            int8_t n = p[layout.unit[i][j]];
+
+            if (!n)
+                continue;
+            if (used[i] & (1 << (n - 1)))
+                return TRIAGE_DUPLICATE_CLUE;
+            used[i] |= (1 << (n - 1));
         }
-    
-        dump (p);
     }
+
+    for (i = 0; i < 81; i++)
     {
-        int16_t candidates[81];
-    
-        int8_t p[] = 
+        if (p[i])
         {
-            7,0,0, 0,0,0, 4,0,0,
-            0,2,0, 0,7,0, 0,8,0,
-            0,0,3, 0,0,8, 0,0,9,
-    
-            0,0,0, 5,0,0, 3,0,0,
-            0,6,0, 0,2,0, 0,9,0,
-            0,0,1, 0,0,7, 0,0,6,
+            cand[i] = 1 << (p[i] - 1);
+            continue;
+        }
 
-            0,0,0, 3,0,0, 9,0,0,
-            0,3,0, 0,4,0, 0,6,0,
-            0,0,9, 0,0,1, 0,3,5
-        };
-    
-        init_candidates (p, candidates);
-    
-        while (saturate (p, candidates))
-            printf ("-\n");
-    
+        for (bits = 0, j = 0; j < layout.nmember[i]; j++)
+            bits |= used[layout.member[i][j]];
+        cand[i] = bits = ~bits & 0x1ff;
+        if (!bits)
+            return TRIAGE_EMPTY_CELL;
+        if (1 != bitcount (bits))
+            continue;
+
+        for (j = 0; j < layout.nmember[i]; j++)
         {
-            int8_t r, cursor = -2;
-            enum state state = STATE_FORWARD;
-    
-            r = 0;
-            while (0 == r)
-                r = step (p, candidates, &cursor, &state);
+            if (forced[layout.member[i][j]] & bits)
+                return TRIAGE_FORCED_TWICE;
+            forced[layout.member[i][j]] |= bits;
         }
-    
-        dump (p);
     }
-    */
+
+    for (i = 0; i < 81; i++)
     {
-        int16_t candidates[81];
-    
-        int8_t p[] = 
+        bits = cand[i];
+        if (!p[i] && 1 != bitcount (bits))
         {
-            5,3,0, 0,7,0, 0,0,0,
-            6,0,0, 1,9,5, 0,0,0,
-            0,9,8, 0,0,0, 0,6,0,
-    
-            8,0,0, 0,6,0, 0,0,3,
-            4,0,0, 8,0,3, 0,0,1,
-            7,0,0, 0,2,0, 0,0,6,
+            for (j = 0; j < layout.nmember[i]; j++)
+                bits &= ~forced[layout.member[i][j]];
+            if (!bits)
+                return TRIAGE_EMPTY_CELL;
+        }
 
-            0,6,0, 0,0,0, 2,8,0,
-            0,0,0, 4,1,9, 0,0,5,
-            0,0,0, 0,8,0, 0,7,9 
-        };
-    
-        init_candidates (p, candidates);
-    
-        while (saturate (p, candidates))
-            printf ("-\n");
-    
+        for (j = 0; j < layout.nmember[i]; j++)
+            seen[layout.member[i][j]] |= bits;
+    }
+
+    for (i = 0; i < layout.nunits; i++)
+        if (0x1ff != seen[i])
+            return TRIAGE_MISSING_VALUE;
+
+    return TRIAGE_OK;
+}
+
+void
+tests4 ()
+{
+    int8_t p[81];
+
+    memset (p, 0, sizeof (p));
+
+    assert (TRIAGE_OK == triage (
+        "530070000600195000098000060800060003400803001700020006060000280000419005000080079\n", p));
+    assert (5 == p[0] && 0 == p[2]);
+    assert (TRIAGE_MALFORMED == triage ("530070000", p));
+    assert (TRIAGE_MALFORMED == triage (
+        "53007000060019500009800006080006000340080300170002000606000028000041900500008007x", p));
+
+    /* The 5 at the end of the first row repeats the first clue */
+    assert (TRIAGE_DUPLICATE_CLUE == triage (
+        "530070005600195000098000060800060003400803001700020006060000280000419005000080079", p));
+
+    /* The first cell sees 1 to 8 in its row and 9 in its column */
+    assert (TRIAGE_EMPTY_CELL == triage (
+        ".12345678" "9........" "........." "........." "........." 
+        "........." "........." "........." ".........", p));
+
+    /* Columns 1 and 9 hold 2 to 9 below row 1, so triage finds 1 forced
+     * into two cells of the same row. */
+    assert (TRIAGE_FORCED_TWICE == triage (
+        "........." "2.......3" "3.......4" "4.......5" "5.......6" 
+        "6.......7" "7.......8" "8.......9" "9.......2", p));
+
+    /* The first row has room for 2 and 3, but not for 1 */
+    assert (TRIAGE_MISSING_VALUE == triage (
+        "...456789" "1........" "........." "........." "........." 
+        "........." "........." "........." ".........", p));
+}
+
+void
+tests7 ()
+{
+    struct planes s;
+    int8_t i;
+    int    ok;
+
+    int8_t p[] = 
+    {
+        5,3,0, 0,7,0, 0,0,0,
+        6,0,0, 1,9,5, 0,0,0,
+        0,9,8, 0,0,0, 0,6,0,
+
+        8,0,0, 0,6,0, 0,0,3,
+        4,0,0, 8,0,3, 0,0,1,
+        7,0,0, 0,2,0, 0,0,6,
+
+        0,6,0, 0,0,0, 2,8,0,
+        0,0,0, 4,1,9, 0,0,5,
+        0,0,0, 0,8,0, 0,7,9 
+    };
+    int8_t q[81];
+
+    /* Propagation on the planes alone solves an easy puzzle */
+    planes_init (p, &s);
+    while (saturate_planes (p, &s))
+        ;
+    assert (!planes_empty (&s));
+    assert (ALL_CELLS == s.solved);
+    for (i = 0; i < 81; i++)
+        assert (p[i] && validate_pos (p, i));
+
+    /* Two peers end up as singletons of the same digit in one pass; the 
+     * second must be left empty rather than assigned.
+     */
+    ok = read_puzzle (
+        ".1..536..9.......76...9.2.31........3...45...287.6....52.9..3.84.85..91.79....452", q);
+    assert (ok);
+    planes_init (q, &s);
+    while (saturate_planes (q, &s))
+        ;
+    assert (planes_empty (&s));
+    for (i = 0; i < 81; i++)
+        assert (0 <= q[i] && q[i] <= 9);
+    (void) ok;
+}
+
+void
+tests8 ()
+{
+    struct layout saved = layout;
+    struct layout l;
+    int16_t seen = 0;
+    int8_t  i, q[81];
+    int     ok;
+
+    /* Cells on a diagonal gain the peers along it */
+    ok = init_layout (&l, "diagonal");
+    assert (ok);
+    assert (29 == l.nunits);
+    assert (4 == l.nmember[0] && 26 == l.npeers[0]);
+    assert (5 == l.nmember[40] && 32 == l.npeers[40]);
+    assert (3 == l.nmember[1] && 20 == l.npeers[1]);
+
+    /* r2c2 lies in the first window, r1c1 in none */
+    ok = init_layout (&l, "windoku");
+    assert (ok);
+    assert (31 == l.nunits);
+    assert (4 == l.nmember[10] && 23 == l.npeers[10]);
+    assert (3 == l.nmember[0] && 20 == l.npeers[0]);
+
+    /* Regions must be 81 labels forming nine regions of nine cells */
+    ok = init_layout (&l, 
+        "jigsaw:111222333111222333111222333444555666444555666444555666777888999777888999777888999");
+    assert (ok);
+    assert (27 == l.nunits && 20 == l.npeers[0]);
+    ok = init_layout (&l, "jigsaw:111222333");
+    assert (!ok);
+    ok = init_layout (&l, 
+        "jigsaw:111222333111222333111222333444555666444555666444555666777888999777888999777888991");
+    assert (!ok);
+    ok = init_layout (&l, "hexagon");
+    assert (!ok);
+
+    /* A diagonal puzzle is solved with both diagonals filled */
+    ok = init_layout (&layout, "diagonal");
+    assert (ok);
+    ok = read_puzzle (
+        "..54.867.3..27.8..4.8......8.4..7..3.9.31..8..3..5.9....27..59695..2...8..358..17", q);
+    assert (ok);
+    ok = solve_cdcl (q, NULL);
+    assert (1 == ok);
+    for (i = 0; i < 81; i++)
+        assert (q[i] && validate_pos (q, i));
+    for (i = 0; i < 9; i++)
+        seen |= 1 << (q[i * 9 + i] - 1);
+    assert (0x1ff == seen);
+
+    layout = saved;
+    (void) ok;
+}
+
+void
+write_puzzle (FILE *f, const int8_t *p)
+{
+    int8_t i;
+
+    for (i = 0; i < 81; i++)
+        fputc ('0' + p[i], f);
+    fputc ('\n', f);
+}
+
+void
+print_hint (FILE *f, const struct hint *h)
+{
+    switch (h->kind)
+    {
+        case HINT_SOLVED:
+            fprintf (f, "Solved\n");
+            break;
+        case HINT_NAKED_SINGLE:
+            fprintf (f, "Naked single: %d at row %d, col %d\n", 
+                     h->value, ROW (h->pos) + 1, COL (h->pos) + 1);
+            break;
+        case HINT_HIDDEN_SINGLE:
+            fprintf (f, "Hidden single (offs. type = %s): %d at row %d, col %d\n", 
+                     offs_type (layout.kind[h->unit]), h->value, ROW (h->pos) + 1, COL (h->pos) + 1);
+            break;
+        case HINT_EMPTY_CELL:
+            fprintf (f, "Contradiction: no value fits row %d, col %d\n", 
+                     ROW (h->pos) + 1, COL (h->pos) + 1);
+            break;
+        case HINT_MISSING_VALUE:
+            fprintf (f, "Contradiction: %d fits nowhere in unit %d (offs. type = %s)\n", 
+                     h->value, h->unit, offs_type (layout.kind[h->unit]));
+            break;
+        default:
+            fprintf (f, "No single found\n");
+    }
+}
+
+/* Interactive mode. Commands are read one per line: "row col value" places
+ * a value (or erases the cell, if the value is 0), and "?" asks for a hint.
+ */
+int
+play (FILE *in, const int8_t *p)
+{
+    struct board bd;
+    struct hint  h;
+    char line[256];
+    int  r, c, n, o, pos;
+
+    if (!board_init (&bd, p))
+    {
+        fprintf (stderr, "conflicting givens\n");
+        return 1;
+    }
+
+    dump (bd.d);
+
+    while (fgets (line, sizeof (line), in))
+    {
+        if ('?' == line[0])
         {
-            int8_t r, cursor = -2;
-            enum state state = STATE_FORWARD;
-    
-            r = 0;
-            while (0 == r)
-                r = step (p, candidates, &cursor, &state);
+            board_hint (&bd, &h);
+            print_hint (stdout, &h);
+            continue;
         }
-    
-        dump (p);
+        if (3 != sscanf (line, "%d %d %d", &r, &c, &n) 
+                || r < 1 || r > 9 || c < 1 || c > 9 || n < 0 || n > 9)
+        {
+            fprintf (stdout, "?\n");
+            continue;
+        }
+        pos = (r - 1) * 9 + (c - 1);
+        if (p[pos])
+        {
+            fprintf (stdout, "Given\n");
+            continue;
+        }
+
+        o = bd.d[pos];
+        board_erase (&bd, pos);
+        if (n && !board_place (&bd, pos, n))
+        {
+            /* Keep the value that was there */
+            if (o)
+                board_place (&bd, pos, o);
+            fprintf (stdout, "Not a candidate\n");
+        }
+
+        dump (bd.d);
+    }
+
+    return 0;
+}
+
+/* Settings of the batch mode, taken from the command line. */
+struct options
+{
+    int           use_lanes;
+    int           use_perf;       /* Report hardware counters per phase */
+    int           use_portfolio;  /* Race the portfolio configurations */
+    long          count_limit;    /* Count solutions, up to this many */
+    long          tt_megabytes;   /* Size of the transposition table */
+    struct config config;
+    struct budget limits;
+};
+
+/* Read puzzles from a stream, one per line, and write each solution on a 
+ * line of its own. Unsolvable, malformed and abandoned puzzles are reported
+ * in place. In counting mode, the number of solutions is written instead.
+ */
+int
+batch (FILE *in, struct options *o)
+{
+    char    line[256];
+    int8_t  p[81];
+    int8_t *puzzles = NULL;
+    int8_t *verdict = NULL;
+    int    *r;
+    long   *counts;
+    long    wins[PORTFOLIO_SIZE + 1] = { 0 };
+    int     i, j, w, n = 0, m = 0, size = 0, timeouts = 0;
+    long    nodes = 0;
+    struct timespec t0, t1;
+    struct perf counters;
+    struct ttable table, 
+                 *tt = NULL;
+
+    while (fgets (line, sizeof (line), in))
+    {
+        /* A line longer than the buffer is read to its end and counts as
+         * one record, which triage rejects; a long comment is skipped. */
+        int overlong = !strchr (line, '\n') && !feof (in);
+
+        if (overlong)
+        {
+            int c;
+
+            while (EOF != (c = fgetc (in)) && '\n' != c)
+                ;
+        }
+
+        if ('\n' == line[0] || '#' == line[0])
+            continue;
+
+        if (n == size)
+        {
+            size = size ? size * 2 : 256;
+            puzzles = realloc (puzzles, size * 81);
+            verdict = realloc (verdict, size);
+        }
+
+        /* Only records which pass triage are queued for the solvers */
+        verdict[n] = overlong ? TRIAGE_MALFORMED : triage (line, p);
+        if (TRIAGE_OK == verdict[n])
+            memcpy (puzzles + m++ * 81, p, 81);
+        n++;
+    }
+
+    r = calloc (m ? m : 1, sizeof (int));
+    counts = calloc (m ? m : 1, sizeof (long));
+
+    if (o->tt_megabytes)
+    {
+        if (tt_init (&table, (size_t) o->tt_megabytes << 20))
+            tt = &table;
+        else
+            fprintf (stderr, "cannot allocate transposition table\n");
+    }
+
+    if (o->use_perf)
+    {
+        if (perf_open (&counters))
+            perf = &counters;
+        else
+            fprintf (stderr, "hardware counters unavailable\n");
+    }
+
+    clock_gettime (CLOCK_MONOTONIC, &t0);
+
+    if (o->use_lanes && !o->count_limit)
+        solve_lanes (puzzles, m, r, &o->config, &o->limits, tt);
+    else
+        for (i = 0; i < m; i++)
+        {
+            if (o->count_limit)
+                r[i] = solve_count (puzzles + i * 81, &o->config, &o->limits, tt,
+                                    o->count_limit, &counts[i]);
+            else if (o->use_portfolio)
+            {
+                r[i] = solve_portfolio (puzzles + i * 81, &o->limits, tt, &w);
+                wins[w + 1]++;
+            }
+            else
+                r[i] = solve (puzzles + i * 81, &o->config, &o->limits, tt);
+            if (!o->use_portfolio)
+                nodes += o->limits.nodes;
+            perf_switch (PHASE_NONE);
+        }
+
+    clock_gettime (CLOCK_MONOTONIC, &t1);
+
+    if (perf)
+    {
+        perf_report (stderr, perf);
+        perf_close (perf);
+        perf = NULL;
+    }
+
+    /* Results of accepted records are indexed by j */
+    for (i = 0, j = -1; i < n; i++)
+    {
+        if (TRIAGE_OK == verdict[i])
+            j++;
+
+        if (TRIAGE_MALFORMED == verdict[i])
+            fprintf (stdout, "malformed\n");
+        else if (TRIAGE_OK != verdict[i])
+            fprintf (stdout, "unsolvable: %s\n", triage_reason (verdict[i]));
+        else if (o->count_limit && 2 != r[j])
+            fprintf (stdout, "%ld\n", counts[j]);
+        else if (1 == r[j])
+            write_puzzle (stdout, puzzles + j * 81);
+        else if (2 == r[j])
+        {
+            fprintf (stdout, "timeout\n");
+            timeouts++;
+        }
+        else
+            fprintf (stdout, "unsolvable\n");
+    }
+
+    fprintf (stderr, "%d puzzles in %.3f ms, %d over budget, %d rejected by triage\n", 
+             n, (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6,
+             timeouts, n - m);
+
+    if (!o->use_portfolio && !(o->use_lanes && !o->count_limit))
+        fprintf (stderr, "%ld search nodes\n", nodes);
+
+    if (o->use_portfolio)
+    {
+        fprintf (stderr, "portfolio wins:");
+        for (i = 0; i < PORTFOLIO_SIZE; i++)
+            fprintf (stderr, " %s %ld,", portfolio[i].name, wins[i + 1]);
+        fprintf (stderr, " none %ld\n", wins[0]);
+    }
+
+    if (tt)
+    {
+        fprintf (stderr, "%ld transposition table hits\n", atomic_load (&tt->hits));
+        tt_free (tt);
+    }
+
+    free (puzzles);
+    free (verdict);
+    free (r);
+    free (counts);
+
+    return 0;
+}
+
+/* Parse a comma separated list of chain techniques, e.g. "xy,color". */
+int
+parse_techniques (const char *s, unsigned *techniques)
+{
+    static const struct { const char *name; unsigned bit; } names[] =
+    {
+        { "xy",    TECH_XY_WING  },
+        { "xyz",   TECH_XYZ_WING },
+        { "color", TECH_COLORING },
+        { "all",   TECH_ALL      },
+        { "none",  0             }
+    };
+    size_t len;
+    int    i;
+
+    *techniques = 0;
+    while (*s)
+    {
+        len = strcspn (s, ",");
+        for (i = 0; i < (int) (sizeof (names) / sizeof (names[0])); i++)
+            if (len == strlen (names[i].name) && !strncmp (s, names[i].name, len))
+                break;
+        if (i == (int) (sizeof (names) / sizeof (names[0])))
+            return 0;
+        *techniques |= names[i].bit;
+        s += len;
+        if (',' == *s)
+            s++;
     }
+    return 1;
 }
 
 int 
 main (int argc, char *argv[])
 {
+    int opt, 
+        use_batch = 0;
+    const char *variant = "standard";
+    const char *interactive = NULL;
+    struct options o;
+
+    memset (&o, 0, sizeof (o));
+    o.config.name = "default";
+    o.config.repr = REPR_CELLS;
+
+    while (-1 != (opt = getopt (argc, argv, "blpmRPcC:i:k:n:s:t:T:v:x:")))
+    {
+        switch (opt)
+        {
+            case 'b': use_batch = 1; break;
+            case 'l': o.use_lanes = 1; break;
+            case 'p': o.config.repr = REPR_PLANES; break;
+            case 'm': o.config.mrv = 1; break;
+            case 'R': o.use_portfolio = 1; break;
+            case 'P': o.use_perf = 1; break;
+            case 'c': o.config.cdcl = 1; break;
+            case 'C': o.limits.cdcl_after = atol (optarg); break;
+            case 'i': interactive = optarg; break;
+            case 'k': o.count_limit = atol (optarg); break;
+            case 'T':
+                o.tt_megabytes = atol (optarg);
+                if (0 >= o.tt_megabytes)
+                {
+                    fprintf (stderr, "%s: invalid table size: %s\n", argv[0], optarg);
+                    return 1;
+                }
+                break;
+            case 'n': o.limits.max_nodes = atol (optarg); break;
+            case 's': o.limits.max_saturate = atol (optarg); break;
+            case 't': o.limits.max_seconds = atof (optarg); break;
+            case 'v': variant = optarg; break;
+            case 'x':
+                if (!parse_techniques (optarg, &o.config.techniques))
+                {
+                    fprintf (stderr, "%s: invalid techniques: %s\n", argv[0], optarg);
+                    return 1;
+                }
+                break;
+            default:
+                fprintf (stderr, "usage: %s [-i puzzle | -b [-l] [-p] [-m] [-R] [-P] [-c] [-C nodes] [-k solutions] [-T megabytes] [-n nodes] [-s passes] [-t seconds] [-x xy,xyz,color]] [-v variant]\n", argv[0]);
+                return 1;
+        }
+    }
+
+    if (!init_layout (&layout, variant))
+    {
+        fprintf (stderr, "%s: invalid variant: %s\n", argv[0], variant);
+        return 1;
+    }
+
+    init_zobrist ();
+
+    if (interactive)
+    {
+        int8_t p[81];
+        enum triage t = triage (interactive, p);
+
+        if (TRIAGE_OK != t)
+        {
+            fprintf (stderr, "%s: rejected puzzle: %s\n", argv[0], triage_reason (t));
+            return 1;
+        }
+        return play (stdin, p);
+    }
+
+    if (use_batch)
+        return batch (stdin, &o);
+
+    /* The test puzzles are standard ones, whatever the variant given */
+    init_layout (&layout, "standard");
+
+    tests8 ();
+    tests7 ();
+    tests6 ();
+    tests5 ();
+    tests4 ();
+    tests3 ();
     tests2 ();
 
     /*
@@ -894,7 +4141,7 @@ main (int argc, char *argv[])
         r = 0;
         while (0 == r)
         {
-            r = step (p, candidates, &cursor, &state);
+            r = step (p, candidates, NULL, &cursor, &state);
         }
 
         dump (p);